@@ -0,0 +1,332 @@
+#include "IoRing.h"
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <poll.h>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+
+// Ops live in the top byte of user_data, tags in the rest
+const int OP_SHIFT = 56;
+const uint64_t TAG_MASK = (uint64_t(1) << OP_SHIFT) - 1;
+// The one provided-buffer group receives pick from
+const uint16_t RECV_GROUP = 0;
+
+static int RingSetup(unsigned entries, io_uring_params* p) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+static int RingEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags, void* arg, size_t argSize) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argSize));
+}
+
+static int RingRegister(int fd, unsigned opcode, void* arg, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+
+static uint64_t UserData(IoRing::Op op, uint64_t tag) {
+    return (static_cast<uint64_t>(op) << OP_SHIFT) | (tag & TAG_MASK);
+}
+
+IoRing::IoRing()
+    : ringFd(-1), ringMem(MAP_FAILED), ringSize(0), sqeMem(MAP_FAILED), sqeSize(0),
+    bufRingMem(MAP_FAILED), bufRingSize(0), sqHead(nullptr), sqTail(nullptr), sqMask(0), sqes(nullptr),
+    cqHead(nullptr), cqTail(nullptr), cqMask(0), cqes(nullptr), bufTail(0),
+    unsubmitted(0), submitting(false) {}
+
+IoRing::~IoRing() {
+    if (ringFd >= 0) close(ringFd);
+    if (bufRingMem != MAP_FAILED) munmap(bufRingMem, bufRingSize);
+    if (sqeMem != MAP_FAILED) munmap(sqeMem, sqeSize);
+    if (ringMem != MAP_FAILED) munmap(ringMem, ringSize);
+}
+
+std::unique_ptr<IoRing> IoRing::Create() {
+    std::unique_ptr<IoRing> ring(new IoRing());
+    if (!ring->Setup()) return nullptr;
+    return ring;
+}
+
+bool IoRing::Setup() {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL;
+    params.cq_entries = RING_CQ_ENTRIES;
+    // ENOSYS on old kernels, EPERM where io_uring is disabled by sysctl or seccomp
+    ringFd = RingSetup(RING_ENTRIES, &params);
+    if (ringFd < 0) return false;
+
+    const unsigned needed = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+    if ((params.features & needed) != needed) return false;
+
+    size_t sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    ringSize = sqSize > cqSize ? sqSize : cqSize;
+    ringMem = mmap(nullptr, ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+    if (ringMem == MAP_FAILED) return false;
+    sqeSize = params.sq_entries * sizeof(io_uring_sqe);
+    sqeMem = mmap(nullptr, sqeSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+    if (sqeMem == MAP_FAILED) return false;
+
+    char* base = static_cast<char*>(ringMem);
+    sqHead = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+    sqTail = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+    sqMask = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+    sqes = sqeMem;
+    // SQE i always sits in slot i, so the index array is filled once
+    unsigned* sqArray = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+    for (unsigned i = 0; i < params.sq_entries; ++i)
+        sqArray[i] = i;
+    cqHead = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+    cqMask = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+    cqes = base + params.cq_off.cqes;
+
+    // Every op we submit must be known; SEND_ZC arrived in the same release
+    // as multishot receive, which has no probe bit of its own
+    std::vector<char> probeMem(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+    io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(probeMem.data());
+    if (RingRegister(ringFd, IORING_REGISTER_PROBE, probe, 256) < 0) return false;
+    for (int op : { IORING_OP_SENDMSG, IORING_OP_RECV, IORING_OP_POLL_ADD, IORING_OP_ASYNC_CANCEL, IORING_OP_SEND_ZC }) {
+        if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) return false;
+    }
+
+    io_uring_rsrc_register files;
+    memset(&files, 0, sizeof(files));
+    files.nr = RING_FILES;
+    files.flags = IORING_RSRC_REGISTER_SPARSE;
+    if (RingRegister(ringFd, IORING_REGISTER_FILES2, &files, sizeof(files)) < 0) return false;
+    for (int i = RING_FILES - 1; i >= 0; --i)
+        freeFiles.push_back(i);
+
+    // Receive buffers, all handed to the kernel up front
+    bufRingSize = RING_RECV_BUFFERS * sizeof(io_uring_buf);
+    bufRingMem = mmap(nullptr, bufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (bufRingMem == MAP_FAILED) return false;
+    recvBuffers.resize(static_cast<size_t>(RING_RECV_BUFFERS) * RING_RECV_BUFFER_SIZE);
+    io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<uint64_t>(bufRingMem);
+    reg.ring_entries = RING_RECV_BUFFERS;
+    reg.bgid = RECV_GROUP;
+    if (RingRegister(ringFd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) return false;
+    for (int bid = 0; bid < RING_RECV_BUFFERS; ++bid)
+        RecycleRecvBuffer(static_cast<uint32_t>(bid) << IORING_CQE_BUFFER_SHIFT);
+
+    sendSlots.reset(new SendSlot[RING_SEND_SLOTS]);
+    for (int i = RING_SEND_SLOTS - 1; i >= 0; --i)
+        freeSendSlots.push_back(i);
+    return true;
+}
+
+int IoRing::RegisterFile(int fd) {
+    std::lock_guard<std::mutex> guard(submitLock);
+    if (freeFiles.empty()) return -1;
+    int index = freeFiles.back();
+    io_uring_files_update update;
+    memset(&update, 0, sizeof(update));
+    update.offset = index;
+    update.fds = reinterpret_cast<uint64_t>(&fd);
+    if (RingRegister(ringFd, IORING_REGISTER_FILES_UPDATE, &update, 1) != 1) return -1;
+    freeFiles.pop_back();
+    return index;
+}
+
+void IoRing::UnregisterFile(int index) {
+    if (index < 0) return;
+    int none = -1;
+    io_uring_files_update update;
+    memset(&update, 0, sizeof(update));
+    update.offset = index;
+    update.fds = reinterpret_cast<uint64_t>(&none);
+    std::lock_guard<std::mutex> guard(submitLock);
+    RingRegister(ringFd, IORING_REGISTER_FILES_UPDATE, &update, 1);
+    freeFiles.push_back(index);
+}
+
+void* IoRing::NextSqe() {
+    unsigned tail = *sqTail;
+    unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+    if (tail - head > sqMask) return nullptr;
+    io_uring_sqe* sqe = static_cast<io_uring_sqe*>(sqes) + (tail & sqMask);
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+void IoRing::Push() {
+    __atomic_store_n(sqTail, *sqTail + 1, __ATOMIC_RELEASE);
+    unsubmitted.fetch_add(1);
+}
+
+template<typename Fill> bool IoRing::Prepare(Fill fill) {
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        {
+            std::lock_guard<std::mutex> guard(submitLock);
+            io_uring_sqe* sqe = static_cast<io_uring_sqe*>(NextSqe());
+            if (sqe) {
+                fill(sqe);
+                Push();
+                break;
+            }
+        }
+        if (attempt == 1) return false;
+        Flush();
+    }
+    Flush();
+    return true;
+}
+
+bool IoRing::QueueSend(int file, bool fixed, const char* data, int len, const sockaddr_in* to) {
+    if (len < 0 || len > RING_SEND_SLOT_SIZE) return false;
+    std::lock_guard<std::mutex> guard(submitLock);
+    if (freeSendSlots.empty()) return false;
+    io_uring_sqe* sqe = static_cast<io_uring_sqe*>(NextSqe());
+    if (!sqe) return false;
+    int index = freeSendSlots.back();
+    freeSendSlots.pop_back();
+
+    SendSlot& slot = sendSlots[index];
+    memcpy(slot.data, data, len);
+    slot.iov.iov_base = slot.data;
+    slot.iov.iov_len = len;
+    memset(&slot.msg, 0, sizeof(slot.msg));
+    if (to) {
+        slot.addr = *to;
+        slot.msg.msg_name = &slot.addr;
+        slot.msg.msg_namelen = sizeof(slot.addr);
+    }
+    slot.msg.msg_iov = &slot.iov;
+    slot.msg.msg_iovlen = 1;
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = file;
+    sqe->flags = fixed ? IOSQE_FIXED_FILE : 0;
+    sqe->addr = reinterpret_cast<uint64_t>(&slot.msg);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = UserData(Op::SEND, index);
+    Push();
+    return true;
+}
+
+void IoRing::ReleaseSendSlot(int slot) {
+    std::lock_guard<std::mutex> guard(submitLock);
+    freeSendSlots.push_back(slot);
+}
+
+bool IoRing::ArmRecv(int file, bool fixed, uint64_t tag) {
+    return Prepare([&](io_uring_sqe* sqe) {
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = file;
+        sqe->flags = IOSQE_BUFFER_SELECT | (fixed ? IOSQE_FIXED_FILE : 0);
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->buf_group = RECV_GROUP;
+        sqe->user_data = UserData(Op::RECV, tag);
+        });
+}
+
+bool IoRing::ArmPoll(int fd, uint64_t tag) {
+    return Prepare([&](io_uring_sqe* sqe) {
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+        sqe->len = IORING_POLL_ADD_MULTI;
+        sqe->poll32_events = POLLIN;
+        sqe->user_data = UserData(Op::POLL, tag);
+        });
+}
+
+void IoRing::Cancel(Op op, uint64_t tag) {
+    Prepare([&](io_uring_sqe* sqe) {
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = UserData(op, tag);
+        sqe->user_data = UserData(Op::CANCEL, 0);
+        });
+}
+
+void IoRing::Flush() {
+    // Every load and store here is seq_cst: a thread that queues an SQE and
+    // then finds submitting set must be sure the submitter's recheck below
+    // sees its count
+    while (unsubmitted.load() > 0) {
+        // Whoever is submitting rechecks the count afterwards and takes ours too
+        if (submitting.exchange(true)) return;
+        unsigned count = unsubmitted.load();
+        int done = 0;
+        if (count > 0) {
+            do {
+                done = RingEnter(ringFd, count, 0, 0, nullptr, 0);
+            } while (done < 0 && errno == EINTR);
+        }
+        if (done > 0) unsubmitted.fetch_sub(done);
+        submitting.store(false);
+        if (done <= 0 && unsubmitted.load() > 0) {
+            // EBUSY or EAGAIN: the kernel wants completions reaped first. The
+            // reaping thread may be blocked in Wait, which does not submit,
+            // so wake it to reap and flush again.
+            if (onStalled) onStalled();
+            return;
+        }
+    }
+}
+
+void IoRing::SetOnStalled(std::function<void()> fn) {
+    onStalled = std::move(fn);
+}
+
+void IoRing::Wait(int timeoutMs) {
+    Flush();
+    if (__atomic_load_n(cqTail, __ATOMIC_ACQUIRE) != *cqHead) return;
+
+    __kernel_timespec ts;
+    io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+    if (timeoutMs >= 0) {
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000000;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+    RingEnter(ringFd, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+}
+
+void IoRing::Reap(const std::function<void(const Completion&)>& fn) {
+    unsigned head = *cqHead;
+    while (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+        const io_uring_cqe* cqe = static_cast<const io_uring_cqe*>(cqes) + (head & cqMask);
+        Completion c;
+        c.op = static_cast<Op>(cqe->user_data >> OP_SHIFT);
+        c.tag = cqe->user_data & TAG_MASK;
+        c.result = cqe->res;
+        c.flags = cqe->flags;
+        // The entry is copied, so the kernel may reuse it while we handle it
+        __atomic_store_n(cqHead, ++head, __ATOMIC_RELEASE);
+
+        if (c.op == Op::SEND) {
+            ReleaseSendSlot(static_cast<int>(c.tag));
+            continue;
+        }
+        if (c.op != Op::CANCEL) fn(c);
+        if (c.flags & IORING_CQE_F_BUFFER) RecycleRecvBuffer(c.flags);
+    }
+}
+
+const char* IoRing::GetRecvBuffer(const Completion& c) const {
+    size_t bid = c.flags >> IORING_CQE_BUFFER_SHIFT;
+    return recvBuffers.data() + bid * RING_RECV_BUFFER_SIZE;
+}
+
+void IoRing::RecycleRecvBuffer(uint32_t flags) {
+    uint16_t bid = static_cast<uint16_t>(flags >> IORING_CQE_BUFFER_SHIFT);
+    // Not io_uring_buf_ring: in C++ its flexible array member is laid out
+    // one entry late. The tail overlays the first entry's resv field.
+    io_uring_buf* bufs = static_cast<io_uring_buf*>(bufRingMem);
+    io_uring_buf& buf = bufs[bufTail & (RING_RECV_BUFFERS - 1)];
+    buf.addr = reinterpret_cast<uint64_t>(recvBuffers.data() + static_cast<size_t>(bid) * RING_RECV_BUFFER_SIZE);
+    buf.len = RING_RECV_BUFFER_SIZE;
+    buf.bid = bid;
+    __atomic_store_n(&bufs[0].resv, static_cast<uint16_t>(++bufTail), __ATOMIC_RELEASE);
+}
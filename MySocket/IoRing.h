@@ -0,0 +1,141 @@
+#pragma once
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Submission queue size; sends beyond this wait for the next flush
+const unsigned RING_ENTRIES = 256;
+// Completion queue size. Every datagram received is one completion, so it
+// is much deeper than the submission queue.
+const unsigned RING_CQ_ENTRIES = 4096;
+// Sockets that can be registered with the ring at once
+const int RING_FILES = 1024;
+// Receive buffers the kernel picks from (a power of two) and their size
+const int RING_RECV_BUFFERS = 512;
+const int RING_RECV_BUFFER_SIZE = 2048;
+// Sends in flight at once, and the largest send that is queued; anything
+// bigger, or any send made while every slot is busy, goes out directly
+const int RING_SEND_SLOTS = 256;
+const int RING_SEND_SLOT_SIZE = 512;
+
+// A thin io_uring wrapper built on the raw syscalls (Linux only), used by
+// the Reactor as its completion-driven backend. Sockets are registered as
+// fixed files, receives stay armed as multishot receives that fill buffers
+// from a ring the kernel picks from, and sends made by any thread are
+// copied into slots and submitted together: whichever thread submits
+// first also carries everything queued behind it.
+//
+// Send completions are handled internally; receive and poll completions
+// are reaped by one thread, the Reactor's.
+class IoRing {
+public:
+    // What a completion belongs to, kept in the top bits of its user_data
+    enum class Op : uint8_t { RECV = 1, POLL, SEND, CANCEL };
+
+    struct Completion {
+        Op op;
+        uint64_t tag;       // the caller's tag, without the op
+        int result;         // bytes, or -errno
+        uint32_t flags;     // IORING_CQE_F_*
+    };
+
+private:
+    int ringFd;
+    void* ringMem;
+    size_t ringSize;
+    void* sqeMem;
+    size_t sqeSize;
+    void* bufRingMem;
+    size_t bufRingSize;
+    std::vector<char> recvBuffers;
+
+    // Submission queue, shared with the kernel
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned sqMask;
+    void* sqes;
+
+    // Completion queue, shared with the kernel
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned cqMask;
+    void* cqes;
+
+    // Provided receive buffers; only the reaping thread recycles them
+    unsigned bufTail;
+    void RecycleRecvBuffer(uint32_t flags);
+
+    struct SendSlot {
+        msghdr msg;
+        iovec iov;
+        sockaddr_in addr;
+        char data[RING_SEND_SLOT_SIZE];
+    };
+    std::unique_ptr<SendSlot[]> sendSlots;
+    std::vector<int> freeSendSlots;
+    std::vector<int> freeFiles;
+
+    std::mutex submitLock;
+    // SQEs written but not yet handed to the kernel
+    std::atomic<unsigned> unsubmitted;
+    std::atomic<bool> submitting;
+    std::function<void()> onStalled;
+
+    IoRing();
+    bool Setup();
+    // A zeroed SQE, or nullptr if the queue is full; needs submitLock
+    void* NextSqe();
+    // Publishes the SQE from NextSqe; needs submitLock
+    void Push();
+    // Fills an SQE for the reaping thread, flushing once if the queue is full
+    template<typename Fill> bool Prepare(Fill fill);
+    void ReleaseSendSlot(int slot);
+
+public:
+    ~IoRing();
+
+    // A ring, or nullptr when the kernel lacks io_uring or any feature it
+    // relies on (multishot receive and buffer rings need Linux 6.0)
+    static std::unique_ptr<IoRing> Create();
+
+    // Installs fd as a fixed file; returns its index, or -1 if the table is full
+    int RegisterFile(int fd);
+    void UnregisterFile(int index);
+
+    // Copies data into a send slot and queues it for file (a fixed file
+    // index if fixed is set); nothing reaches the kernel until Flush.
+    // Returns false if it could not be queued, so the caller sends directly.
+    bool QueueSend(int file, bool fixed, const char* data, int len, const sockaddr_in* to);
+
+    // Arms a multishot receive on a connected or client socket
+    bool ArmRecv(int file, bool fixed, uint64_t tag);
+    // Arms a multishot readiness poll on any fd
+    bool ArmPoll(int fd, uint64_t tag);
+    // Cancels the armed receive or poll with this op and tag
+    void Cancel(Op op, uint64_t tag);
+
+    // Hands every queued SQE to the kernel, unless another thread is already
+    // doing so and will pick them up
+    void Flush();
+
+    // Called when Flush has to leave SQEs queued because the kernel refused
+    // them; it should wake the thread in Wait, whose next Wait flushes
+    // again. Set before the ring is shared between threads.
+    void SetOnStalled(std::function<void()> fn);
+
+    // Submits anything queued and blocks until a completion arrives or
+    // timeoutMs passes (-1 = no limit)
+    void Wait(int timeoutMs);
+
+    // Calls fn for each receive and poll completion waiting. A receive
+    // buffer goes back to the kernel as soon as fn returns.
+    void Reap(const std::function<void(const Completion&)>& fn);
+
+    // The buffer a receive completion filled (only valid inside Reap's fn)
+    const char* GetRecvBuffer(const Completion& c) const;
+};
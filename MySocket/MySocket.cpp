@@ -2,14 +2,20 @@
 #include <iostream>
 #include <cstring>
 
+#ifdef __linux__
+#include "IoRing.h"
+#endif
+
 #ifdef _WIN32
 #pragma comment(lib, "ws2_32.lib")
 #endif
 
-MySocket::MySocket(SocketType type, std::string ip, unsigned int port, ConnectionType connType, unsigned int bufSize)
-    : mySocket(type), IPAddr(ip), Port(port), connectionType(connType), MaxSize(bufSize), bTCPConnect(false)
+MySocket::MySocket(SocketType type, std::string ip, unsigned int port, ConnectionType connType, unsigned int bufSize, IoRing* ring)
+    : mySocket(type), IPAddr(ip), Port(port), connectionType(connType), MaxSize(bufSize), bTCPConnect(false), bNonBlocking(false),
+    Ring(nullptr), RingFile(-1), bRingRecv(false), StagedData(nullptr), StagedLen(-1)
 {
     Buffer = new char[MaxSize];
+    Received = Buffer;
 
 #ifdef _WIN32
     WSADATA wsaData;
@@ -29,9 +35,26 @@ MySocket::MySocket(SocketType type, std::string ip, unsigned int port, Connectio
     if (mySocket == SocketType::SERVER && connectionType == ConnectionType::UDP) {
         bind(ConnectionSocket, (struct sockaddr*)&SvrAddr, sizeof(SvrAddr));
     }
+
+#ifdef __linux__
+    if (ring) {
+        Ring = ring;
+        RingFile = ring->RegisterFile(ConnectionSocket);
+    }
+#endif
+}
+
+// A registered socket stays open inside the ring until it is unregistered
+void MySocket::ReleaseRing() {
+#ifdef __linux__
+    if (Ring) Ring->UnregisterFile(RingFile);
+#endif
+    Ring = nullptr;
+    RingFile = -1;
 }
 
 MySocket::~MySocket() {
+    ReleaseRing();
 #ifdef _WIN32
     closesocket(ConnectionSocket);
     if (mySocket == SocketType::SERVER && connectionType == ConnectionType::TCP)
@@ -47,19 +70,46 @@ MySocket::~MySocket() {
 }
 
 void MySocket::SendData(const char* data, int len) {
+#ifdef __linux__
+    // TCP sends stay synchronous so a stream is never cut short or reordered
+    if (Ring && connectionType == ConnectionType::UDP) {
+        bool fixed = RingFile >= 0;
+        if (Ring->QueueSend(fixed ? RingFile : ConnectionSocket, fixed, data, len, &SvrAddr)) {
+            Ring->Flush();
+            return;
+        }
+    }
+#endif
     if (connectionType == ConnectionType::UDP) {
         sendto(ConnectionSocket, data, len, 0, (struct sockaddr*)&SvrAddr, sizeof(SvrAddr));
     }
     else if (connectionType == ConnectionType::TCP) {
-        send(ConnectionSocket, data, len, 0);
+        send(ConnectionSocket, data, len, SEND_FLAGS);
     }
 }
 
 int MySocket::GetData(char* outBuf) {
     int bytes = 0;
+    if (bRingRecv) {
+        // The ring already did the read; hand over what it staged, once
+        bytes = StagedLen;
+        if (bytes < 0) return -1;
+        Received = StagedData;
+        StagedLen = -1;
+        if (bytes > 0 && outBuf != nullptr) {
+            memcpy(outBuf, Received, bytes);
+        }
+        return bytes;
+    }
+
+    Received = Buffer;
     if (connectionType == ConnectionType::UDP) {
-        socklen_t addrlen = sizeof(SvrAddr);
-        bytes = recvfrom(ConnectionSocket, Buffer, MaxSize, 0, (struct sockaddr*)&SvrAddr, &addrlen);
+        // Only a server follows the sender; a client keeps replying to its robot
+        // even if a stray datagram arrives, and SendData never races this write.
+        sockaddr_in fromAddr;
+        sockaddr_in* src = (mySocket == SocketType::SERVER) ? &SvrAddr : &fromAddr;
+        socklen_t addrlen = sizeof(sockaddr_in);
+        bytes = recvfrom(ConnectionSocket, Buffer, MaxSize, 0, (struct sockaddr*)src, &addrlen);
     }
     else {
         bytes = recv(ConnectionSocket, Buffer, MaxSize, 0);
@@ -71,9 +121,154 @@ int MySocket::GetData(char* outBuf) {
     return bytes;
 }
 
+int MySocket::SendBatch(Datagram* msgs, int count) {
+    if (connectionType == ConnectionType::TCP) {
+        int sent = 0;
+        for (; sent < count; ++sent) {
+            if (send(ConnectionSocket, msgs[sent].data, msgs[sent].len, SEND_FLAGS) < 0) break;
+        }
+        return sent;
+    }
+
+#ifdef __linux__
+    int sent = 0;
+    if (Ring) {
+        bool fixed = RingFile >= 0;
+        int file = fixed ? RingFile : ConnectionSocket;
+        for (; sent < count; ++sent) {
+            const sockaddr_in* to = msgs[sent].addr ? msgs[sent].addr : &SvrAddr;
+            if (!Ring->QueueSend(file, fixed, msgs[sent].data, msgs[sent].len, to)) {
+                // Submitting frees queue space; if that is not enough, sendmmsg the rest
+                Ring->Flush();
+                if (!Ring->QueueSend(file, fixed, msgs[sent].data, msgs[sent].len, to)) break;
+            }
+        }
+        Ring->Flush();
+    }
+
+    mmsghdr hdrs[MAX_BATCH];
+    iovec iovs[MAX_BATCH];
+    while (sent < count) {
+        int chunk = (count - sent < MAX_BATCH) ? count - sent : MAX_BATCH;
+        for (int i = 0; i < chunk; ++i) {
+            Datagram& d = msgs[sent + i];
+            iovs[i].iov_base = d.data;
+            iovs[i].iov_len = d.len;
+            memset(&hdrs[i].msg_hdr, 0, sizeof(hdrs[i].msg_hdr));
+            hdrs[i].msg_hdr.msg_name = d.addr ? d.addr : &SvrAddr;
+            hdrs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            hdrs[i].msg_hdr.msg_iov = &iovs[i];
+            hdrs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int n = sendmmsg(ConnectionSocket, hdrs, chunk, 0);
+        if (n <= 0) break;
+        sent += n;
+    }
+    return sent;
+#else
+    int sent = 0;
+    for (; sent < count; ++sent) {
+        const sockaddr_in* to = msgs[sent].addr ? msgs[sent].addr : &SvrAddr;
+        if (sendto(ConnectionSocket, msgs[sent].data, msgs[sent].len, 0, (const struct sockaddr*)to, sizeof(sockaddr_in)) < 0) break;
+    }
+    return sent;
+#endif
+}
+
+int MySocket::RecvBatch(Datagram* msgs, int count) {
+    if (count <= 0) return 0;
+    if (count > MAX_BATCH) count = MAX_BATCH;
+
+    if (connectionType == ConnectionType::TCP) {
+        int bytes = recv(ConnectionSocket, msgs[0].data, msgs[0].len, 0);
+        if (bytes <= 0) return -1;
+        msgs[0].len = bytes;
+        return 1;
+    }
+
+#ifdef __linux__
+    mmsghdr hdrs[MAX_BATCH];
+    iovec iovs[MAX_BATCH];
+    for (int i = 0; i < count; ++i) {
+        iovs[i].iov_base = msgs[i].data;
+        iovs[i].iov_len = msgs[i].len;
+        memset(&hdrs[i].msg_hdr, 0, sizeof(hdrs[i].msg_hdr));
+        hdrs[i].msg_hdr.msg_name = msgs[i].addr;
+        hdrs[i].msg_hdr.msg_namelen = msgs[i].addr ? sizeof(sockaddr_in) : 0;
+        hdrs[i].msg_hdr.msg_iov = &iovs[i];
+        hdrs[i].msg_hdr.msg_iovlen = 1;
+    }
+    int n = recvmmsg(ConnectionSocket, hdrs, count, MSG_WAITFORONE, nullptr);
+    for (int i = 0; i < n; ++i)
+        msgs[i].len = hdrs[i].msg_len;
+    return n > 0 ? n : -1;
+#else
+    int received = 0;
+    for (; received < count; ++received) {
+        // Only the first receive may block; after that take what is queued
+        if (received > 0) {
+#ifdef _WIN32
+            WSAPOLLFD pfd = { ConnectionSocket, POLLRDNORM, 0 };
+            if (WSAPoll(&pfd, 1, 0) <= 0) break;
+#else
+            pollfd pfd = { ConnectionSocket, POLLIN, 0 };
+            if (poll(&pfd, 1, 0) <= 0) break;
+#endif
+        }
+        socklen_t addrlen = sizeof(sockaddr_in);
+        int bytes = recvfrom(ConnectionSocket, msgs[received].data, msgs[received].len, 0, (struct sockaddr*)msgs[received].addr, msgs[received].addr ? &addrlen : nullptr);
+        if (bytes < 0) break;
+        msgs[received].len = bytes;
+    }
+    return received > 0 ? received : -1;
+#endif
+}
+
+int MySocket::GetData(char* outBuf, int timeoutMs) {
+    // Polling would race the ring for the data; take only what it staged
+    if (bRingRecv) return StagedLen >= 0 ? GetData(outBuf) : 0;
+#ifdef _WIN32
+    WSAPOLLFD pfd = { ConnectionSocket, POLLRDNORM, 0 };
+    int ready = WSAPoll(&pfd, 1, timeoutMs);
+#else
+    pollfd pfd = { ConnectionSocket, POLLIN, 0 };
+    int ready = poll(&pfd, 1, timeoutMs);
+#endif
+    if (ready <= 0) return 0;
+    return GetData(outBuf);
+}
+
+void MySocket::SetNonBlocking(bool enable) {
+#ifdef _WIN32
+    u_long mode = enable ? 1 : 0;
+    ioctlsocket(ConnectionSocket, FIONBIO, &mode);
+#else
+    int flags = fcntl(ConnectionSocket, F_GETFL, 0);
+    fcntl(ConnectionSocket, F_SETFL, enable ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+#endif
+    bNonBlocking = enable;
+}
+
+bool MySocket::IsNonBlocking() { return bNonBlocking; }
+socket_t MySocket::GetHandle() { return ConnectionSocket; }
+const char* MySocket::GetBuffer() { return Received; }
+
+void MySocket::SetTimeout(int ms) {
+#ifdef _WIN32
+    DWORD tv = ms;
+#else
+    timeval tv;
+    tv.tv_sec = ms / 1000;
+    tv.tv_usec = (ms % 1000) * 1000;
+#endif
+    setsockopt(ConnectionSocket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&tv, sizeof(tv));
+}
+
 std::string MySocket::GetIPAddr() { return IPAddr; }
 int MySocket::GetPort() { return Port; }
 SocketType MySocket::GetType() { return mySocket; }
+ConnectionType MySocket::GetConnectionType() { return connectionType; }
+bool MySocket::IsTCPConnected() { return bTCPConnect; }
 
 void MySocket::SetIPAddr(std::string ip) {
     if (!bTCPConnect) IPAddr = ip;
@@ -100,6 +295,7 @@ void MySocket::ConnectTCP() {
 
 void MySocket::DisconnectTCP() {
     if (connectionType == ConnectionType::TCP && bTCPConnect) {
+        ReleaseRing();
 #ifdef _WIN32
         closesocket(ConnectionSocket);
 #else
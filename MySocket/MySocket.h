@@ -8,15 +8,39 @@ typedef SOCKET socket_t;
 #else
 #include <sys/socket.h>
 #include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
 typedef int socket_t;
 #endif
 
+// A robot dropping its TCP connection must not kill the controller with SIGPIPE
+#ifdef MSG_NOSIGNAL
+const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+const int SEND_FLAGS = 0;
+#endif
+
 enum class SocketType { CLIENT, SERVER };
 enum class ConnectionType { TCP, UDP };
 
 const int DEFAULT_SIZE = 1024;
 
+// Largest number of datagrams SendBatch/RecvBatch hand the kernel per syscall
+const int MAX_BATCH = 64;
+
+// One datagram in a SendBatch/RecvBatch call.
+// Send: len is the byte count; addr is the destination (nullptr = the socket's peer).
+// Receive: len is the capacity on input and the bytes received on output;
+// addr, if set, receives the sender's address.
+struct Datagram {
+    char* data;
+    int len;
+    sockaddr_in* addr;
+};
+
+class IoRing;
+
 class MySocket {
 private:
     char* Buffer;
@@ -29,10 +53,27 @@ private:
     std::string IPAddr;
     int Port;
     bool bTCPConnect;
+    bool bNonBlocking;
     int MaxSize;
 
+    // io_uring backend (Linux only): the ring and this socket's fixed file
+    // index in it. While a Reactor keeps a receive armed (bRingRecv), it
+    // stages each completed receive here for the next GetData.
+    IoRing* Ring;
+    int RingFile;
+    bool bRingRecv;
+    const char* Received;
+    const char* StagedData;
+    int StagedLen;
+    friend class Reactor;
+
+    void ReleaseRing();
+
 public:
-    MySocket(SocketType, std::string, unsigned int, ConnectionType, unsigned int);
+    // With a ring (from Reactor::GetRing), UDP sends are queued on it and a
+    // Reactor watching the socket receives through it; without one, or on
+    // other platforms, every call is a plain syscall
+    MySocket(SocketType, std::string, unsigned int, ConnectionType, unsigned int, IoRing* ring = nullptr);
     ~MySocket();
 
     void ConnectTCP();
@@ -40,6 +81,32 @@ public:
     void SendData(const char*, int);
     int GetData(char*);
 
+    // Sends count datagrams with as few syscalls as possible (sendmmsg on Linux).
+    // Returns how many were sent.
+    int SendBatch(Datagram*, int count);
+
+    // Receives up to count datagrams already queued (recvmmsg on Linux), waiting
+    // only for the first one unless the socket is non-blocking. Returns how many
+    // were received, or -1 if none were.
+    int RecvBatch(Datagram*, int count);
+
+    // Waits at most timeoutMs for data; returns 0 if the deadline passes first
+    int GetData(char*, int timeoutMs);
+
+    // Sets a receive timeout in milliseconds (0 = block forever)
+    void SetTimeout(int);
+
+    // In non-blocking mode GetData returns -1 straight away when nothing is queued
+    void SetNonBlocking(bool);
+    bool IsNonBlocking();
+
+    // Data from the last receive; after GetData(nullptr) it holds the data just
+    // read, valid until the next receive on this socket
+    const char* GetBuffer();
+
+    // Native handle, for registering the socket with a Reactor
+    socket_t GetHandle();
+
     std::string GetIPAddr();
     void SetIPAddr(std::string);
     void SetPort(int);
@@ -48,6 +115,9 @@ public:
     SocketType GetType();
     void SetType(SocketType);
 
+    ConnectionType GetConnectionType();
+    bool IsTCPConnected();
+
     // Extra for testing
     void ForceConnect();
 };
\ No newline at end of file
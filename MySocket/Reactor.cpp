@@ -0,0 +1,295 @@
+#include "Reactor.h"
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <cerrno>
+
+const int MAX_EVENTS = 64;
+
+// Ring completions carry the fd in the low half of their tag and the
+// watcher's generation above it; the wake fd uses generation 0
+const uint32_t MAX_GENERATION = 0xFFFFFF;
+
+static uint64_t Tag(int fd, uint32_t generation) {
+    return (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd);
+}
+
+Reactor::Reactor(IoBackend preferred) : epollFd(-1), running(true), nextGeneration(1), nextTimerId(1) {
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (preferred == IoBackend::IO_URING)
+        ring = IoRing::Create();
+    if (ring)
+        ring->SetOnStalled([this]() { Wake(); });
+    if (!ring) {
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.fd = wakeFd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+    }
+
+    loop = std::thread(&Reactor::Run, this);
+}
+
+Reactor::~Reactor() {
+    Stop();
+    close(wakeFd);
+    if (epollFd >= 0) close(epollFd);
+}
+
+IoBackend Reactor::GetBackend() const {
+    return ring ? IoBackend::IO_URING : IoBackend::EPOLL;
+}
+
+IoRing* Reactor::GetRing() { return ring.get(); }
+
+void Reactor::Stop() {
+    if (!running.exchange(false)) return;
+    Wake();
+    if (loop.joinable()) loop.join();
+}
+
+bool Reactor::IsReactorThread() const {
+    return std::this_thread::get_id() == loop.get_id();
+}
+
+// Interrupts epoll_wait so a new earliest deadline or shutdown is noticed
+void Reactor::Wake() {
+    uint64_t one = 1;
+    ssize_t ignored = write(wakeFd, &one, sizeof(one));
+    (void)ignored;
+}
+
+// Waits for a callback running on the loop thread, unless we are that callback
+void Reactor::WaitForCallbacks() {
+    if (IsReactorThread()) return;
+    std::lock_guard<std::mutex> wait(callbackLock);
+}
+
+bool Reactor::Watch(MySocket& sock, Callback onReadable) {
+    sock.SetNonBlocking(true);
+    int fd = sock.GetHandle();
+
+    if (ring) {
+        // A UDP server needs each sender's address, which only recvfrom gives it
+        bool completion = sock.Ring == ring.get()
+            && !(sock.GetType() == SocketType::SERVER && sock.GetConnectionType() == ConnectionType::UDP);
+        uint32_t generation;
+        {
+            std::lock_guard<std::mutex> guard(stateLock);
+            generation = nextGeneration;
+            nextGeneration = nextGeneration % MAX_GENERATION + 1;
+            watchers[fd] = { std::make_shared<Callback>(std::move(onReadable)), &sock, generation, completion };
+        }
+        sock.bRingRecv = completion;
+        // Arming from the loop thread keeps the receive's work on that thread
+        if (IsReactorThread())
+            Arm(fd, generation);
+        else
+            RunAt(Clock::now(), [this, fd, generation]() { Arm(fd, generation); });
+        return true;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(stateLock);
+        watchers[fd] = { std::make_shared<Callback>(std::move(onReadable)), &sock, 0, false };
+    }
+
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        std::lock_guard<std::mutex> guard(stateLock);
+        watchers.erase(fd);
+        return false;
+    }
+    return true;
+}
+
+void Reactor::Unwatch(MySocket& sock) {
+    int fd = sock.GetHandle();
+    if (!ring) epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    Watcher gone = { nullptr, nullptr, 0, false };
+    {
+        std::lock_guard<std::mutex> guard(stateLock);
+        auto it = watchers.find(fd);
+        if (it != watchers.end()) {
+            gone = it->second;
+            watchers.erase(it);
+        }
+    }
+    if (ring && gone.fn)
+        ring->Cancel(gone.completion ? IoRing::Op::RECV : IoRing::Op::POLL, Tag(fd, gone.generation));
+    WaitForCallbacks();
+    sock.bRingRecv = false;
+    sock.StagedLen = -1;
+}
+
+Reactor::TimerId Reactor::RunAt(Clock::time_point deadline, Callback fn) {
+    bool earliest;
+    TimerId id;
+    {
+        std::lock_guard<std::mutex> guard(stateLock);
+        id = nextTimerId++;
+        earliest = timers.empty() || deadline < timers.begin()->first.first;
+        timers.emplace(std::make_pair(deadline, id), std::move(fn));
+        timerDeadlines[id] = deadline;
+    }
+    if (earliest && !IsReactorThread()) Wake();
+    return id;
+}
+
+Reactor::TimerId Reactor::RunAfter(std::chrono::milliseconds delay, Callback fn) {
+    return RunAt(Clock::now() + delay, std::move(fn));
+}
+
+void Reactor::CancelTimer(TimerId id) {
+    {
+        std::lock_guard<std::mutex> guard(stateLock);
+        auto it = timerDeadlines.find(id);
+        if (it != timerDeadlines.end()) {
+            timers.erase(std::make_pair(it->second, id));
+            timerDeadlines.erase(it);
+        }
+    }
+    WaitForCallbacks();
+}
+
+// Milliseconds until the earliest timer, rounded up; -1 when there is none
+int Reactor::NextTimeoutMs() {
+    std::lock_guard<std::mutex> guard(stateLock);
+    if (timers.empty()) return -1;
+    auto wait = timers.begin()->first.first - Clock::now();
+    if (wait <= Clock::duration::zero()) return 0;
+    return static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(wait).count());
+}
+
+void Reactor::RunDueTimers() {
+    auto now = Clock::now();
+    while (true) {
+        Callback fn;
+        {
+            std::lock_guard<std::mutex> guard(stateLock);
+            if (timers.empty() || timers.begin()->first.first > now) return;
+            auto it = timers.begin();
+            fn = std::move(it->second);
+            timerDeadlines.erase(it->first.second);
+            timers.erase(it);
+        }
+        fn();
+    }
+}
+
+void Reactor::Run() {
+    if (ring)
+        RunRing();
+    else
+        RunEpoll();
+}
+
+void Reactor::RunEpoll() {
+    epoll_event events[MAX_EVENTS];
+    while (running) {
+        int n = epoll_wait(epollFd, events, MAX_EVENTS, NextTimeoutMs());
+
+        std::lock_guard<std::mutex> busy(callbackLock);
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wakeFd) {
+                uint64_t drained;
+                ssize_t ignored = read(wakeFd, &drained, sizeof(drained));
+                (void)ignored;
+                continue;
+            }
+
+            std::shared_ptr<Callback> fn;
+            {
+                std::lock_guard<std::mutex> guard(stateLock);
+                auto it = watchers.find(fd);
+                if (it != watchers.end()) fn = it->second.fn;
+            }
+            if (fn) (*fn)();
+        }
+        RunDueTimers();
+    }
+}
+
+void Reactor::RunRing() {
+    ring->ArmPoll(wakeFd, Tag(wakeFd, 0));
+    while (running) {
+        ring->Wait(NextTimeoutMs());
+
+        std::lock_guard<std::mutex> busy(callbackLock);
+        ring->Reap([this](const IoRing::Completion& c) { OnCompletion(c); });
+        RunDueTimers();
+    }
+}
+
+// Starts (or restarts) a watcher's multishot receive or poll, unless it
+// was unwatched in the meantime
+void Reactor::Arm(int fd, uint32_t generation) {
+    MySocket* sock;
+    bool completion;
+    {
+        std::lock_guard<std::mutex> guard(stateLock);
+        auto it = watchers.find(fd);
+        if (it == watchers.end() || it->second.generation != generation) return;
+        sock = it->second.sock;
+        completion = it->second.completion;
+    }
+    if (!completion)
+        ring->ArmPoll(fd, Tag(fd, generation));
+    else if (sock->RingFile >= 0)
+        ring->ArmRecv(sock->RingFile, true, Tag(fd, generation));
+    else
+        ring->ArmRecv(fd, false, Tag(fd, generation));
+}
+
+void Reactor::OnCompletion(const IoRing::Completion& c) {
+    int fd = static_cast<int>(c.tag & 0xFFFFFFFF);
+    uint32_t generation = static_cast<uint32_t>(c.tag >> 32);
+    bool more = (c.flags & IORING_CQE_F_MORE) != 0;
+
+    if (generation == 0 && fd == wakeFd) {
+        uint64_t drained;
+        ssize_t ignored = read(wakeFd, &drained, sizeof(drained));
+        (void)ignored;
+        if (!more) ring->ArmPoll(wakeFd, Tag(wakeFd, 0));
+        return;
+    }
+
+    std::shared_ptr<Callback> fn;
+    MySocket* sock = nullptr;
+    {
+        std::lock_guard<std::mutex> guard(stateLock);
+        auto it = watchers.find(fd);
+        if (it != watchers.end() && it->second.generation == generation) {
+            fn = it->second.fn;
+            sock = it->second.sock;
+        }
+    }
+    // Unwatched since it was armed; any buffer goes back when we return
+    if (!fn) return;
+
+    if (c.op == IoRing::Op::POLL) {
+        (*fn)();
+        if (!more) Arm(fd, generation);
+        return;
+    }
+
+    if (c.result >= 0) {
+        sock->StagedData = c.result > 0 ? ring->GetRecvBuffer(c) : nullptr;
+        sock->StagedLen = c.result;
+        (*fn)();
+        // The buffer is about to be recycled; drop it if the callback left it
+        std::lock_guard<std::mutex> guard(stateLock);
+        auto it = watchers.find(fd);
+        if (it != watchers.end() && it->second.generation == generation)
+            sock->StagedLen = -1;
+    }
+    // A multishot receive stops when the kernel runs out of buffers (we just
+    // gave some back) or on an error or EOF, which are not worth retrying
+    if (!more && (c.result > 0 || c.result == -ENOBUFS))
+        Arm(fd, generation);
+}
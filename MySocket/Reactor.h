@@ -0,0 +1,100 @@
+#pragma once
+#include "MySocket.h"
+#include "IoRing.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+// How a Reactor waits. IO_URING falls back to EPOLL on kernels that cannot
+// provide everything IoRing needs.
+enum class IoBackend { EPOLL, IO_URING };
+
+// Single-threaded event loop (Linux only). One Reactor thread services
+// readiness callbacks for any number of non-blocking MySocket objects plus
+// one-shot deadline timers.
+//
+// With the io_uring backend the thread waits on completions instead of
+// readiness: sockets built with GetRing() keep a multishot receive armed, and
+// each callback finds the completed receive waiting in GetData, so no recv
+// syscall is made at all. Other sockets get a multishot readiness poll and
+// behave exactly as under epoll.
+class Reactor {
+public:
+    typedef std::function<void()> Callback;
+    typedef uint64_t TimerId;
+    typedef std::chrono::steady_clock Clock;
+
+private:
+    struct Watcher {
+        std::shared_ptr<Callback> fn;
+        MySocket* sock;
+        // Tells a stale completion from one for a newer socket with the same fd
+        uint32_t generation;
+        // Receives complete on the ring rather than being polled for
+        bool completion;
+    };
+
+    int epollFd;
+    int wakeFd;
+    std::unique_ptr<IoRing> ring;
+    std::atomic<bool> running;
+    std::thread loop;
+
+    // Held while a callback runs so Unwatch/CancelTimer can wait it out
+    std::mutex callbackLock;
+    std::mutex stateLock;
+    std::unordered_map<int, Watcher> watchers;
+    uint32_t nextGeneration;
+    std::map<std::pair<Clock::time_point, TimerId>, Callback> timers;
+    std::unordered_map<TimerId, Clock::time_point> timerDeadlines;
+    TimerId nextTimerId;
+
+    void Run();
+    void RunEpoll();
+    void RunRing();
+    void Arm(int fd, uint32_t generation);
+    void OnCompletion(const IoRing::Completion& c);
+    void Wake();
+    int NextTimeoutMs();
+    void RunDueTimers();
+    void WaitForCallbacks();
+
+public:
+    // Sets up the backend and starts the event loop thread
+    explicit Reactor(IoBackend preferred = IoBackend::EPOLL);
+    ~Reactor();
+
+    // The backend actually in use
+    IoBackend GetBackend() const;
+
+    // Ring to build sockets with, so their sends and receives go through it;
+    // nullptr under epoll
+    IoRing* GetRing();
+
+    // Switches the socket to non-blocking mode and calls onReadable on the
+    // reactor thread each time data is waiting. The callback should drain the
+    // socket with GetData until it returns <= 0.
+    bool Watch(MySocket& sock, Callback onReadable);
+
+    // Stops watching a socket; returns once its callback is no longer running
+    void Unwatch(MySocket& sock);
+
+    // Runs fn once on the reactor thread at (or just after) the deadline
+    TimerId RunAt(Clock::time_point deadline, Callback fn);
+    TimerId RunAfter(std::chrono::milliseconds delay, Callback fn);
+
+    // Cancels a pending timer; returns once it can no longer fire
+    void CancelTimer(TimerId id);
+
+    // Stops the loop thread; called by the destructor
+    void Stop();
+
+    bool IsReactorThread() const;
+};
@@ -0,0 +1,37 @@
+#include "RttEstimator.h"
+
+RttEstimator::RttEstimator() : srttUs(0), rttvarUs(0), rtoUs(INITIAL_RTO.count()) {}
+
+void RttEstimator::Sample(std::chrono::microseconds rtt) {
+    int64_t r = rtt.count() > 0 ? rtt.count() : 1;
+    if (srttUs == 0) {
+        srttUs = r;
+        rttvarUs = r / 2;
+    }
+    else {
+        // RTTVAR uses the old SRTT, so it is updated first
+        int64_t error = srttUs > r ? srttUs - r : r - srttUs;
+        rttvarUs = (3 * rttvarUs + error) / 4;
+        srttUs = (7 * srttUs + r) / 8;
+    }
+
+    int64_t rto = srttUs + 4 * rttvarUs;
+    if (rto < MIN_RTO.count()) rto = MIN_RTO.count();
+    if (rto > MAX_RTO.count()) rto = MAX_RTO.count();
+    rtoUs.store(rto, std::memory_order_relaxed);
+}
+
+std::chrono::microseconds RttEstimator::GetRto() const {
+    return std::chrono::microseconds(rtoUs.load(std::memory_order_relaxed));
+}
+
+std::chrono::microseconds RttEstimator::GetSmoothedRtt() const {
+    return std::chrono::microseconds(srttUs);
+}
+
+std::chrono::microseconds RttEstimator::Backoff(std::chrono::microseconds rto, int attempt) {
+    int64_t us = rto.count();
+    for (int i = 0; i < attempt && us < MAX_RTO.count(); ++i)
+        us *= 2;
+    return std::chrono::microseconds(us < MAX_RTO.count() ? us : MAX_RTO.count());
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Bounds on the retransmission timeout. Robots sit on a LAN, so the floor is
+// far below TCP's one second.
+const std::chrono::microseconds MIN_RTO(10000);
+const std::chrono::microseconds MAX_RTO(2000000);
+// Used until the first RTT sample arrives
+const std::chrono::microseconds INITIAL_RTO(200000);
+
+// Retransmission timeout from measured round trips, per Jacobson/Karels
+// (RFC 6298): SRTT and RTTVAR are exponentially weighted averages of the
+// RTT and its deviation, and RTO = SRTT + 4 * RTTVAR. Feed it only RTTs of
+// packets that were sent once (Karn's rule); a retransmitted packet's reply
+// could belong to either copy.
+//
+// Sample and GetSmoothedRtt belong to one thread; GetRto may be called
+// from any thread.
+class RttEstimator {
+private:
+    int64_t srttUs;
+    int64_t rttvarUs;
+    std::atomic<int64_t> rtoUs;
+
+public:
+    RttEstimator();
+
+    void Sample(std::chrono::microseconds rtt);
+
+    std::chrono::microseconds GetRto() const;
+    // Zero until the first sample
+    std::chrono::microseconds GetSmoothedRtt() const;
+
+    // Timeout for the attempt-th retransmission: doubles each time, up to MAX_RTO
+    static std::chrono::microseconds Backoff(std::chrono::microseconds rto, int attempt);
+};
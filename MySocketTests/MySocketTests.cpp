@@ -1,6 +1,7 @@
 ﻿#include "pch.h"
 #include "CppUnitTest.h"
 #include "../MySocket/MySocket.h"
+#include "../MySocket/RttEstimator.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
@@ -250,6 +251,141 @@ namespace MySocketTests
 			Assert::IsTrue(true); // No crash = pass
 		}
 
+		// Test 19: Verifies GetData with a deadline gives up when nothing arrives
+		TEST_METHOD(Test19_GetData_Timeout_ReturnsZero)
+		{
+			// Arrange
+			MySocket server(SocketType::SERVER, "127.0.0.1", 8121, ConnectionType::UDP, 512);
+			char buffer[512] = {};
+
+			// Act
+			int bytes = server.GetData(buffer, 50);
+
+			// Assert
+			Assert::AreEqual(0, bytes);
+		}
+
+		// Test 20: Verifies non-blocking GetData returns immediately on an empty socket
+		TEST_METHOD(Test20_GetData_NonBlocking_ReturnsWithoutData)
+		{
+			// Arrange
+			MySocket server(SocketType::SERVER, "127.0.0.1", 8122, ConnectionType::UDP, 512);
+			server.SetNonBlocking(true);
+			char buffer[512] = {};
+
+			// Act
+			int bytes = server.GetData(buffer);
+
+			// Assert
+			Assert::IsTrue(server.IsNonBlocking());
+			Assert::IsTrue(bytes <= 0);
+		}
+
+		// Test 21: Verifies GetData with a deadline returns a datagram that is already queued
+		TEST_METHOD(Test21_GetData_Timeout_ReceivesQueuedData)
+		{
+			// Arrange
+			MySocket server(SocketType::SERVER, "127.0.0.1", 8123, ConnectionType::UDP, 512);
+			MySocket client(SocketType::CLIENT, "127.0.0.1", 8123, ConnectionType::UDP, 512);
+			char buffer[512] = {};
+
+			// Act
+			client.SendData("Ping", 4);
+			int bytes = server.GetData(buffer, 1000);
+
+			// Assert
+			Assert::AreEqual(4, bytes);
+			Assert::AreEqual(std::string("Ping"), std::string(buffer, bytes));
+		}
+
+		// Test 22: Sends three datagrams in one batch and receives them in one batch
+		TEST_METHOD(Test22_SendBatch_RecvBatch_UDP_RoundTrip)
+		{
+			// Arrange
+			MySocket server(SocketType::SERVER, "127.0.0.1", 8124, ConnectionType::UDP, 512);
+			MySocket client(SocketType::CLIENT, "127.0.0.1", 8124, ConnectionType::UDP, 512);
+			char a[] = "one", b[] = "two", c[] = "three";
+			Datagram out[3] = { { a, 3, nullptr }, { b, 3, nullptr }, { c, 5, nullptr } };
+			char bufs[3][64] = {};
+			sockaddr_in from[3];
+			Datagram in[3] = { { bufs[0], 64, &from[0] }, { bufs[1], 64, &from[1] }, { bufs[2], 64, &from[2] } };
+
+			// Act
+			int sent = client.SendBatch(out, 3);
+			Sleep(100);
+			int received = server.RecvBatch(in, 3);
+
+			// Assert
+			Assert::AreEqual(3, sent);
+			Assert::AreEqual(3, received);
+			Assert::AreEqual(std::string("two"), std::string(in[1].data, in[1].len));
+			Assert::AreEqual(std::string("three"), std::string(in[2].data, in[2].len));
+			Assert::AreEqual((int)htonl(INADDR_LOOPBACK), (int)from[0].sin_addr.s_addr);
+		}
+
 		
+
+		// Test 23: First RTT sample sets SRTT = R and RTTVAR = R/2, so RTO = 3R
+		TEST_METHOD(Test23_RttEstimator_FirstSample_SetsRto)
+		{
+			// Arrange
+			RttEstimator rtt;
+			std::chrono::microseconds before = rtt.GetRto();
+
+			// Act
+			rtt.Sample(std::chrono::microseconds(20000));
+
+			// Assert
+			Assert::AreEqual((long long)INITIAL_RTO.count(), (long long)before.count());
+			Assert::AreEqual(20000LL, (long long)rtt.GetSmoothedRtt().count());
+			Assert::AreEqual(60000LL, (long long)rtt.GetRto().count());
+		}
+
+		// Test 24: A steady RTT drives RTTVAR toward zero, so RTO settles near the RTT
+		TEST_METHOD(Test24_RttEstimator_SteadySamples_Converge)
+		{
+			// Arrange
+			RttEstimator rtt;
+
+			// Act
+			for (int i = 0; i < 100; ++i)
+				rtt.Sample(std::chrono::microseconds(30000));
+
+			// Assert
+			Assert::AreEqual(30000LL, (long long)rtt.GetSmoothedRtt().count());
+			Assert::IsTrue(rtt.GetRto().count() < 31000);
+		}
+
+		// Test 25: RTO never drops below MIN_RTO or rises above MAX_RTO
+		TEST_METHOD(Test25_RttEstimator_Rto_Clamped)
+		{
+			// Arrange
+			RttEstimator fast, slow;
+
+			// Act
+			fast.Sample(std::chrono::microseconds(100));
+			slow.Sample(std::chrono::microseconds(5000000));
+
+			// Assert
+			Assert::AreEqual((long long)MIN_RTO.count(), (long long)fast.GetRto().count());
+			Assert::AreEqual((long long)MAX_RTO.count(), (long long)slow.GetRto().count());
+		}
+
+		// Test 26: Each retransmission doubles the timeout, up to MAX_RTO
+		TEST_METHOD(Test26_RttEstimator_Backoff_DoublesAndCaps)
+		{
+			// Arrange
+			std::chrono::microseconds rto(100000);
+
+			// Act
+			std::chrono::microseconds first = RttEstimator::Backoff(rto, 1);
+			std::chrono::microseconds third = RttEstimator::Backoff(rto, 3);
+			std::chrono::microseconds many = RttEstimator::Backoff(rto, 40);
+
+			// Assert
+			Assert::AreEqual(200000LL, (long long)first.count());
+			Assert::AreEqual(800000LL, (long long)third.count());
+			Assert::AreEqual((long long)MAX_RTO.count(), (long long)many.count());
+		}
 	};
 }
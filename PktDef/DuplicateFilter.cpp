@@ -0,0 +1,29 @@
+#include "DuplicateFilter.h"
+#include <cstring>
+
+DuplicateFilter::DuplicateFilter() {
+    for (Entry& e : entries) {
+        e.used = false;
+        e.pktCount = 0;
+        e.length = 0;
+    }
+}
+
+const char* DuplicateFilter::Find(int pktCount, int& length) const {
+    const Entry& e = entries[pktCount & (DEDUPE_HISTORY - 1)];
+    if (!e.used || e.pktCount != static_cast<uint16_t>(pktCount)) return nullptr;
+    length = e.length;
+    return e.reply;
+}
+
+void DuplicateFilter::Remember(int pktCount, const char* reply, int length) {
+    Entry& e = entries[pktCount & (DEDUPE_HISTORY - 1)];
+    if (length > DEDUPE_MAX_REPLY) {
+        e.used = false;
+        return;
+    }
+    e.used = true;
+    e.pktCount = static_cast<uint16_t>(pktCount);
+    e.length = static_cast<uint8_t>(length);
+    memcpy(e.reply, reply, length);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+
+// How many recent pktCounts a robot remembers
+const int DEDUPE_HISTORY = 64;
+// Longest reply kept for replay; ACKs and telemetry are well under this
+const int DEDUPE_MAX_REPLY = 32;
+
+// Robot-side half of reliable delivery. When the controller retransmits, the
+// robot may see a command twice; replaying the reply it already sent keeps
+// a repeated DRIVE from running twice. Slots are picked by the low bits of
+// the pktCount, so the last DEDUPE_HISTORY consecutive counts are always
+// remembered, and by the time the 16-bit count wraps its slot has long
+// been reused.
+class DuplicateFilter {
+private:
+    struct Entry {
+        bool used;
+        uint16_t pktCount;
+        uint8_t length;
+        char reply[DEDUPE_MAX_REPLY];
+    };
+
+    Entry entries[DEDUPE_HISTORY];
+
+public:
+    DuplicateFilter();
+
+    // The reply already sent for pktCount, or nullptr if it is new
+    const char* Find(int pktCount, int& length) const;
+
+    // Records the reply sent for pktCount. Replies longer than
+    // DEDUPE_MAX_REPLY are not kept, so their repeats are handled afresh.
+    void Remember(int pktCount, const char* reply, int length);
+};
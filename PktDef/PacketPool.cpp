@@ -0,0 +1,214 @@
+#include "PacketPool.h"
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace {
+    struct ThreadCache;
+
+    // Shared by all threads; only touched on a miss, an overflow or thread exit
+    struct Depot {
+        std::mutex lock;
+        std::vector<char*> free;
+        std::vector<std::unique_ptr<char[]>> slabs;
+        std::vector<ThreadCache*> caches;
+        // Counts from threads that have exited (or are exiting)
+        uint64_t exitedHits = 0;
+        uint64_t exitedMisses = 0;
+
+        // Adds a fresh slab's blocks to the free list; call with the lock held
+        void Carve() {
+            slabs.emplace_back(new char[PACKET_SLAB_BLOCKS * PACKET_BLOCK_SIZE]);
+            char* slab = slabs.back().get();
+            for (int i = 0; i < PACKET_SLAB_BLOCKS; ++i)
+                free.push_back(slab + i * PACKET_BLOCK_SIZE);
+        }
+    };
+
+    // Never destroyed: threads may still return blocks during static destruction
+    Depot& GetDepot() {
+        static Depot* depot = new Depot;
+        return *depot;
+    }
+
+    struct ThreadCache {
+        std::vector<char*> free;
+        // Written only by the owning thread; read by GetHits/GetMisses
+        std::atomic<uint64_t> hits;
+        std::atomic<uint64_t> misses;
+
+        ThreadCache() : hits(0), misses(0) {
+            free.reserve(PACKET_CACHE_BLOCKS + 1);
+            Depot& depot = GetDepot();
+            std::lock_guard<std::mutex> guard(depot.lock);
+            depot.caches.push_back(this);
+        }
+
+        ~ThreadCache() {
+            Depot& depot = GetDepot();
+            std::lock_guard<std::mutex> guard(depot.lock);
+            depot.free.insert(depot.free.end(), free.begin(), free.end());
+            depot.exitedHits += hits.load(std::memory_order_relaxed);
+            depot.exitedMisses += misses.load(std::memory_order_relaxed);
+            for (auto it = depot.caches.begin(); it != depot.caches.end(); ++it) {
+                if (*it == this) {
+                    depot.caches.erase(it);
+                    break;
+                }
+            }
+        }
+
+        // Takes a slab's worth of blocks from the depot, carving a new slab
+        // if it has too few
+        void Refill() {
+            Depot& depot = GetDepot();
+            std::lock_guard<std::mutex> guard(depot.lock);
+            if (depot.free.size() < static_cast<size_t>(PACKET_SLAB_BLOCKS))
+                depot.Carve();
+            auto first = depot.free.end() - PACKET_SLAB_BLOCKS;
+            free.insert(free.end(), first, depot.free.end());
+            depot.free.erase(first, depot.free.end());
+        }
+
+        // Gives a slab's worth back once this thread holds too many
+        void Drain() {
+            Depot& depot = GetDepot();
+            std::lock_guard<std::mutex> guard(depot.lock);
+            auto first = free.end() - PACKET_SLAB_BLOCKS;
+            depot.free.insert(depot.free.end(), first, free.end());
+            free.erase(first, free.end());
+        }
+    };
+
+    // Trivially destructible, so still readable while thread_locals with
+    // destructors are being torn down
+    thread_local ThreadCache* current = nullptr;
+    thread_local bool exited = false;
+
+    struct CacheOwner {
+        ThreadCache cache;
+        CacheOwner() { current = &cache; }
+        ~CacheOwner() {
+            current = nullptr;
+            exited = true;
+        }
+    };
+
+    // This thread's cache, or nullptr once the thread is exiting (buffers
+    // freed by static destructors land here), in which case blocks come
+    // from and go to the depot directly
+    ThreadCache* GetCache() {
+        if (!current && !exited) {
+            thread_local CacheOwner owner;
+        }
+        return current;
+    }
+
+    void Bump(std::atomic<uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+}
+
+char* PacketPool::Acquire() {
+    ThreadCache* cache = GetCache();
+    if (!cache) {
+        Depot& depot = GetDepot();
+        std::lock_guard<std::mutex> guard(depot.lock);
+        depot.exitedMisses++;
+        if (depot.free.empty()) depot.Carve();
+        char* block = depot.free.back();
+        depot.free.pop_back();
+        return block;
+    }
+    if (cache->free.empty()) {
+        Bump(cache->misses);
+        cache->Refill();
+    }
+    else {
+        Bump(cache->hits);
+    }
+    char* block = cache->free.back();
+    cache->free.pop_back();
+    return block;
+}
+
+void PacketPool::Release(char* block) {
+    ThreadCache* cache = GetCache();
+    if (!cache) {
+        Depot& depot = GetDepot();
+        std::lock_guard<std::mutex> guard(depot.lock);
+        depot.free.push_back(block);
+        return;
+    }
+    cache->free.push_back(block);
+    if (cache->free.size() > static_cast<size_t>(PACKET_CACHE_BLOCKS))
+        cache->Drain();
+}
+
+uint64_t PacketPool::GetHits() {
+    Depot& depot = GetDepot();
+    std::lock_guard<std::mutex> guard(depot.lock);
+    uint64_t total = depot.exitedHits;
+    for (ThreadCache* cache : depot.caches)
+        total += cache->hits.load(std::memory_order_relaxed);
+    return total;
+}
+
+uint64_t PacketPool::GetMisses() {
+    Depot& depot = GetDepot();
+    std::lock_guard<std::mutex> guard(depot.lock);
+    uint64_t total = depot.exitedMisses;
+    for (ThreadCache* cache : depot.caches)
+        total += cache->misses.load(std::memory_order_relaxed);
+    return total;
+}
+
+PacketBuffer::PacketBuffer() : block(nullptr), length(0), pooled(false) {}
+
+PacketBuffer::PacketBuffer(const char* raw, int size) : block(nullptr), length(0), pooled(false) {
+    if (size <= 0) return;
+    pooled = size <= PACKET_BLOCK_SIZE;
+    block = pooled ? PacketPool::Acquire() : new char[size];
+    std::memcpy(block, raw, size);
+    length = size;
+}
+
+PacketBuffer::PacketBuffer(PacketBuffer&& other) noexcept
+    : block(std::exchange(other.block, nullptr)), length(std::exchange(other.length, 0)), pooled(other.pooled) {}
+
+PacketBuffer& PacketBuffer::operator=(PacketBuffer&& other) noexcept {
+    if (this != &other) {
+        Free();
+        block = std::exchange(other.block, nullptr);
+        length = std::exchange(other.length, 0);
+        pooled = other.pooled;
+    }
+    return *this;
+}
+
+PacketBuffer::~PacketBuffer() {
+    Free();
+}
+
+void PacketBuffer::Free() {
+    if (!block) return;
+    if (pooled) PacketPool::Release(block);
+    else delete[] block;
+    block = nullptr;
+    length = 0;
+}
+
+const char* PacketBuffer::data() const {
+    return block;
+}
+
+size_t PacketBuffer::size() const {
+    return static_cast<size_t>(length);
+}
+
+bool PacketBuffer::empty() const {
+    return length == 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Every block holds one whole packet (MAXPKTSIZE rounded up)
+const int PACKET_BLOCK_SIZE = 256;
+// Blocks carved from the heap at once, and moved between a thread and the
+// shared depot at once
+const int PACKET_SLAB_BLOCKS = 64;
+// Free blocks a thread keeps before handing a slab's worth back
+const int PACKET_CACHE_BLOCKS = 4 * PACKET_SLAB_BLOCKS;
+
+// Fixed-size packet buffers for the long-running controller, so replies and
+// retransmit copies never go through the general heap. Each thread keeps
+// its own free list and takes no lock to acquire or release a block. Only
+// when that list runs dry (a miss) or overflows does it trade a slab's
+// worth with a shared depot, which carves new slabs as needed. Slabs are
+// never returned to the heap, so the pool stays at its high-water mark and
+// never fragments.
+//
+// A block may be released on a different thread from the one that took it.
+class PacketPool {
+public:
+    // A PACKET_BLOCK_SIZE block
+    static char* Acquire();
+    static void Release(char* block);
+
+    // Acquires served from the calling thread's free list, and those that
+    // went to the depot; summed over all threads, past and present
+    static uint64_t GetHits();
+    static uint64_t GetMisses();
+};
+
+// Owns one packet's bytes in a pooled block. Move-only; empty when default
+// constructed or moved from. Bytes that do not fit a block (only a
+// malformed oversize datagram) go to the heap instead.
+class PacketBuffer {
+private:
+    char* block;
+    int length;
+    bool pooled;
+
+    void Free();
+
+public:
+    PacketBuffer();
+    PacketBuffer(const char* raw, int size);
+    PacketBuffer(PacketBuffer&& other) noexcept;
+    PacketBuffer& operator=(PacketBuffer&& other) noexcept;
+    PacketBuffer(const PacketBuffer&) = delete;
+    PacketBuffer& operator=(const PacketBuffer&) = delete;
+    ~PacketBuffer();
+
+    // Same names as std::vector, which this replaces
+    const char* data() const;
+    size_t size() const;
+    bool empty() const;
+};
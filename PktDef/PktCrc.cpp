@@ -0,0 +1,128 @@
+#include "PktCrc.h"
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define PKTCRC_X86 1
+#include <immintrin.h>
+#endif
+
+// Below these sizes the wider kernels' setup costs more than it saves
+const int POPCNT_MIN_SIZE = 16;
+const int AVX2_MIN_SIZE = 64;
+
+namespace {
+
+// Built at compile time so no static-init ordering can observe it empty
+struct BitTable {
+    uint8_t bits[256];
+    constexpr BitTable() : bits() {
+        for (int i = 1; i < 256; ++i)
+            bits[i] = static_cast<uint8_t>((i & 1) + bits[i / 2]);
+    }
+};
+constexpr BitTable table;
+
+#ifdef PKTCRC_X86
+__attribute__((target("popcnt")))
+unsigned CountPopcnt(const unsigned char* p, int size) {
+    unsigned count = 0;
+    int i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, p + i, 8);
+        count += static_cast<unsigned>(__builtin_popcountll(word));
+    }
+    for (; i < size; ++i)
+        count += table.bits[p[i]];
+    return count;
+}
+
+__attribute__((target("avx2,popcnt")))
+unsigned CountAVX2(const unsigned char* p, int size) {
+    const __m256i lookup = _mm256_setr_epi8(
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+        0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0F);
+    __m256i total = _mm256_setzero_si256();
+
+    int i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low));
+        __m256i hi = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+        // Per-byte counts are at most 8, so summing into 64-bit lanes cannot overflow
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256()));
+    }
+
+    unsigned count = static_cast<unsigned>(
+        _mm256_extract_epi64(total, 0) + _mm256_extract_epi64(total, 1) +
+        _mm256_extract_epi64(total, 2) + _mm256_extract_epi64(total, 3));
+    return count + CountPopcnt(p + i, size - i);
+}
+
+bool HasPopcnt() {
+    static const bool supported = __builtin_cpu_supports("popcnt");
+    return supported;
+}
+
+bool HasAVX2() {
+    static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+    return supported;
+}
+#endif
+
+}
+
+uint8_t CountBitsLoop(const char* buf, int size) {
+    uint8_t count = 0;
+    for (int i = 0; i < size; ++i) {
+        uint8_t b = buf[i];
+        while (b) {
+            count += b & 1;
+            b >>= 1;
+        }
+    }
+    return count;
+}
+
+uint8_t CountBitsTable(const char* buf, int size) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(buf);
+    unsigned count = 0;
+    for (int i = 0; i < size; ++i)
+        count += table.bits[p[i]];
+    return static_cast<uint8_t>(count);
+}
+
+uint8_t CountBitsPopcnt(const char* buf, int size) {
+#ifdef PKTCRC_X86
+    if (HasPopcnt())
+        return static_cast<uint8_t>(CountPopcnt(reinterpret_cast<const unsigned char*>(buf), size));
+#endif
+    return CountBitsTable(buf, size);
+}
+
+uint8_t CountBitsAVX2(const char* buf, int size) {
+#ifdef PKTCRC_X86
+    if (HasAVX2())
+        return static_cast<uint8_t>(CountAVX2(reinterpret_cast<const unsigned char*>(buf), size));
+#endif
+    return CountBitsPopcnt(buf, size);
+}
+
+uint8_t CountBits(const char* buf, int size) {
+#ifdef PKTCRC_X86
+    if (size >= AVX2_MIN_SIZE && HasAVX2())
+        return static_cast<uint8_t>(CountAVX2(reinterpret_cast<const unsigned char*>(buf), size));
+    if (size >= POPCNT_MIN_SIZE && HasPopcnt())
+        return static_cast<uint8_t>(CountPopcnt(reinterpret_cast<const unsigned char*>(buf), size));
+#endif
+    return CountBitsTable(buf, size);
+}
+
+const char* CountBitsKernel(int size) {
+#ifdef PKTCRC_X86
+    if (size >= AVX2_MIN_SIZE && HasAVX2()) return "avx2";
+    if (size >= POPCNT_MIN_SIZE && HasPopcnt()) return "popcnt";
+#endif
+    return "table";
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+
+// Kernels for the packet CRC, which is the number of 1-bits in the buffer
+// (mod 256). All kernels return exactly the same value as the original
+// bit-at-a-time loop; CountBits picks the fastest one this CPU supports.
+
+// Reference kernel: shifts through each byte one bit at a time
+uint8_t CountBitsLoop(const char* buf, int size);
+
+// 256-entry lookup table, one load per byte
+uint8_t CountBitsTable(const char* buf, int size);
+
+// Hardware popcount over 8-byte words (table kernel if the CPU lacks POPCNT)
+uint8_t CountBitsPopcnt(const char* buf, int size);
+
+// AVX2 nibble-lookup popcount, 32 bytes per step (popcount kernel if the CPU lacks AVX2)
+uint8_t CountBitsAVX2(const char* buf, int size);
+
+// Dispatches to the best kernel for this CPU and buffer size
+uint8_t CountBits(const char* buf, int size);
+
+// Name of the kernel CountBits would use for a buffer of this size
+const char* CountBitsKernel(int size);
+
+// 1-bits in a 16-bit header field, for updating a CRC when only that field
+// changes: the CRC is a plain sum, so it moves by new bits minus old bits
+constexpr uint8_t CountWordBits(uint16_t v) {
+    unsigned x = v - ((v >> 1) & 0x5555u);
+    x = (x & 0x3333u) + ((x >> 2) & 0x3333u);
+    x = (x + (x >> 4)) & 0x0F0Fu;
+    return static_cast<uint8_t>((x + (x >> 8)) & 0x1Fu);
+}
@@ -1,5 +1,5 @@
 #include "PktDef.h"
-#include <iostream>
+#include "PktCrc.h"
 #include <cstring>
 
 // Default constructor
@@ -7,9 +7,8 @@ PktDef::PktDef() {
     header.pktCount = 0;
     header.flags = 0;
     header.length = 0;
-    data = nullptr;
+    hasBody = false;
     crc = 0;
-    rawBuffer = nullptr;
 }
 
 // Constructs object from raw packet bufferr
@@ -20,15 +19,14 @@ PktDef::PktDef(char* rawData) {
 
     int bodyLength = header.length - HEADERSIZE - 1;
     if (bodyLength > 0) {
-        data = new char[bodyLength];
-        memcpy(data, rawData + 5, bodyLength);
+        memcpy(data, rawData + HEADERSIZE, bodyLength);
+        hasBody = true;
     }
     else {
-        data = nullptr;
+        hasBody = false;
     }
 
     crc = rawData[header.length - 1];
-    rawBuffer = nullptr;
 }
 
 // Sets the command type using bitmask encoding
@@ -54,21 +52,34 @@ void PktDef::SetAck(bool ack) {
         header.flags &= 0b11110111;
 }
 
+// Sets the packet count and adjusts the CRC in place
+void PktDef::UpdatePktCount(int count) {
+    uint16_t next = static_cast<uint16_t>(count);
+    crc = static_cast<uint8_t>(crc - CountWordBits(header.pktCount) + CountWordBits(next));
+    header.pktCount = next;
+}
+
+// Sets the ACK flag and adjusts the CRC in place
+void PktDef::UpdateAck(bool ack) {
+    if (ack == GetAck()) return;
+    SetAck(ack);
+    crc = static_cast<uint8_t>(ack ? crc + 1 : crc - 1);
+}
+
 // Populates body with raw data and updates length
 void PktDef::SetBodyData(char* inputData, int size) {
-    if (data) delete[] data;
-    data = new char[size];
-    memcpy(data, inputData, size);
+    if (size > MAXBODYSIZE) size = MAXBODYSIZE;
+    if (size > 0) memcpy(data, inputData, size);
+    hasBody = true;
     header.length = HEADERSIZE + size + 1; // +1 for CRC
 }
 
 // build Drive command body
 void PktDef::SetDriveBody(uint8_t dir, uint8_t dur, uint8_t spd) {
-    if (data) delete[] data;
-    data = new char[3];
     data[0] = dir;
     data[1] = dur;
     data[2] = spd;
+    hasBody = true;
     header.length = HEADERSIZE + 3 + 1;
 }
 
@@ -88,12 +99,12 @@ bool PktDef::GetAck() {
 // Getter functions
 int PktDef::GetPktCount() { return header.pktCount; }
 int PktDef::GetLength() { return header.length; }
-char* PktDef::GetBodyData() { return data; }
+char* PktDef::GetBodyData() { return hasBody ? data : nullptr; }
 
 // Parses DriveBody struct from 3-byte drive command payload
 DriveBody PktDef::GetDriveBody() {
     DriveBody d = { 0, 0, 0 };
-    if (data && header.length >= HEADERSIZE + 3 + 1) {
+    if (hasBody && header.length >= HEADERSIZE + 3 + 1) {
         d.direction = data[0];
         d.duration = data[1];
         d.speed = data[2];
@@ -106,7 +117,7 @@ Telemetry PktDef::ParseTelemetry() {
     Telemetry t = { 0 };
 
     int bodyLength = header.length - HEADERSIZE - 1;
-    if (!data || bodyLength < 7) return t;
+    if (!hasBody || bodyLength < 7) return t;
 
     // Robot is likely sending big-endian
     t.lastPktCounter = static_cast<uint16_t>((data[0] << 8) | data[1]);
@@ -115,45 +126,22 @@ Telemetry PktDef::ParseTelemetry() {
     t.lastCmd = static_cast<uint8_t>(data[4]);
     t.lastCmdValue = static_cast<uint8_t>(data[5]);
     t.lastCmdSpeed = static_cast<uint8_t>(data[6]);
-
-    std::cout << "[Telemetry] Parsed:\n"
-        << "  Pkt: " << t.lastPktCounter
-        << ", Grade: " << (int)t.currentGrade
-        << ", Hit: " << (int)t.hitCount
-        << ", Cmd: " << (int)t.lastCmd
-        << ", Val: " << (int)t.lastCmdValue
-        << ", Spd: " << (int)t.lastCmdSpeed << std::endl;
-
     return t;
 }
 
 // Computes CRC by counting all 1-bits across the packet
 void PktDef::CalcCRC() {
-    uint8_t count = 0;
-
     // 1. Calculate Header
-    uint8_t tempHeader[HEADERSIZE];
+    char tempHeader[HEADERSIZE];
     memcpy(tempHeader, &header.pktCount, 2);
     tempHeader[2] = header.flags;
     tempHeader[3] = header.length;
-
-    for (int i = 0; i < HEADERSIZE; ++i) {
-        uint8_t b = tempHeader[i];
-        while (b) {
-            count += b & 1;
-            b >>= 1;
-        }
-    }
+    uint8_t count = CountBits(tempHeader, HEADERSIZE);
 
     // 2. Calculate Body
     int bodyLength = header.length - HEADERSIZE - 1;
-    for (int i = 0; i < bodyLength; ++i) {
-        uint8_t b = data[i];
-        while (b) {
-            count += b & 1;
-            b >>= 1;
-        }
-    }
+    if (bodyLength > 0)
+        count += CountBits(data, bodyLength);
 
     crc = count;
 }
@@ -161,15 +149,8 @@ void PktDef::CalcCRC() {
 
 // Verifies CRC matches computed value for given buffer
 bool PktDef::CheckCRC(char* input, int size) {
-    uint8_t count = 0;
-    for (int i = 0; i < size - 1; i++) {
-        uint8_t b = input[i];
-        while (b) {
-            count += b & 1;
-            b >>= 1;
-        }
-    }
-    return count == static_cast<uint8_t>(input[size - 1]);
+    if (size < 1) return false;
+    return CountBits(input, size - 1) == static_cast<uint8_t>(input[size - 1]);
 }
 
 uint8_t PktDef::GetCRC() const {
@@ -178,26 +159,26 @@ uint8_t PktDef::GetCRC() const {
 
 // Serializes packet header + body + CRC into rawBuffer
 char* PktDef::GenPacket() {
-    if (rawBuffer) delete[] rawBuffer;
-    rawBuffer = new char[header.length];
+    SerializeInto(rawBuffer, MAXPKTSIZE);
+    return rawBuffer;
+}
 
-    memcpy(rawBuffer, &header.pktCount, 2);
-    rawBuffer[2] = header.flags;
-    rawBuffer[3] = header.length;
+// Serializes packet header + body + CRC into a caller-provided buffer
+int PktDef::SerializeInto(char* out, int size) const {
+    if (size < header.length || header.length < HEADERSIZE + 1) return 0;
+
+    memcpy(out, &header.pktCount, 2);
+    out[2] = header.flags;
+    out[3] = header.length;
 
     int bodyLength = header.length - HEADERSIZE - 1;
-    if (bodyLength > 0 && data) {
-        memcpy(rawBuffer + 4, data, bodyLength);
+    if (bodyLength > 0 && hasBody) {
+        memcpy(out + HEADERSIZE, data, bodyLength);
     }
 
-    rawBuffer[header.length - 1] = crc;
-    return rawBuffer;
+    out[header.length - 1] = crc;
+    return header.length;
 }
 
-
-
-// Destructor to free allocated memory
-PktDef::~PktDef() {
-    if (data) delete[] data;
-    if (rawBuffer) delete[] rawBuffer;
-}
\ No newline at end of file
+// Nothing to free: body and raw buffer are inline
+PktDef::~PktDef() {}
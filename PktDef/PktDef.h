@@ -8,6 +8,8 @@ const int BACKWARD = 2;
 const int RIGHT = 3;
 const int LEFT = 4;
 const int HEADERSIZE = 4; // PktCount(2) + Flags(1) + Length(1)
+const int MAXPKTSIZE = 255; // Length is a uint8_t
+const int MAXBODYSIZE = MAXPKTSIZE - HEADERSIZE - 1; // minus header and CRC
 
 struct DriveBody {
     uint8_t direction;
@@ -32,10 +34,13 @@ private:
         uint8_t length;
     };
 
+    // Body and serialized packet live inline so building a packet never
+    // touches the heap
     Header header;
-    char* data;
+    char data[MAXBODYSIZE];
+    bool hasBody;
     uint8_t crc;
-    char* rawBuffer;
+    char rawBuffer[MAXPKTSIZE];
 
 public:
     // Default constructor initializes an empty packet
@@ -54,6 +59,12 @@ public:
     // Sets the ACK flag ON or OFF
     void SetAck(bool val);
 
+    // Like SetPktCount and SetAck, but also move the CRC by the bits that
+    // changed instead of leaving it for CalcCRC. The CRC stays correct only
+    // if it was correct before, i.e. CalcCRC ran after the last other setter.
+    void UpdatePktCount(int count);
+    void UpdateAck(bool val);
+
     // Sets raw body data and updates packet length (for custom payloads)
     void SetBodyData(char* inputData, int size);
 
@@ -87,4 +98,8 @@ public:
 
     // Serializes the packet into rawBuffer and returns it
     char* GenPacket();
+
+    // Serializes the packet into a caller-provided buffer.
+    // Returns the bytes written, or 0 if the buffer is too small.
+    int SerializeInto(char* out, int size) const;
 };
\ No newline at end of file
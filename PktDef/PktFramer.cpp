@@ -0,0 +1,125 @@
+#include "PktFramer.h"
+#include <cstring>
+
+// Smallest legal packet: header + CRC with an empty body
+const int MINPKTSIZE = HEADERSIZE + 1;
+
+// The CRC is only a bit count, so a misaligned candidate matches it
+// often enough that a real packet also sets exactly one command flag
+static bool LooksLikePacket(const PktView& candidate) {
+    uint8_t cmd = static_cast<uint8_t>(candidate.GetRaw()[2]) & 0b00000111;
+    return (cmd == 0b001 || cmd == 0b010 || cmd == 0b100) && candidate.CheckCRC();
+}
+
+PktFramer::PktFramer()
+    : stashLen(0), stashDelivered(0), input(nullptr), inputLen(0), inputPos(0), droppedBytes(0) {}
+
+void PktFramer::Feed(const char* data, int size) {
+    input = data;
+    inputLen = size;
+    inputPos = 0;
+}
+
+// Completes a packet that started in an earlier read
+bool PktFramer::FillStash(PktView& out) {
+    if (stashDelivered > 0) {
+        // The packet handed out last time is done with; keep what followed it
+        stashLen -= stashDelivered;
+        memmove(stash, stash + stashDelivered, stashLen);
+        stashDelivered = 0;
+    }
+
+    const int startPos = inputPos;
+    while (stashLen > 0) {
+        int avail = inputLen - inputPos;
+        if (stashLen < HEADERSIZE) {
+            int take = HEADERSIZE - stashLen < avail ? HEADERSIZE - stashLen : avail;
+            memcpy(stash + stashLen, input + inputPos, take);
+            stashLen += take;
+            inputPos += take;
+            if (stashLen < HEADERSIZE) return false;
+            avail -= take;
+        }
+
+        int length = static_cast<uint8_t>(stash[3]);
+        if (length < MINPKTSIZE) {
+            // Cannot be a packet start: slide forward one byte and retry
+            memmove(stash, stash + 1, --stashLen);
+            ++droppedBytes;
+            continue;
+        }
+
+        if (stashLen < length) {
+            int take = length - stashLen < avail ? length - stashLen : avail;
+            memcpy(stash + stashLen, input + inputPos, take);
+            stashLen += take;
+            inputPos += take;
+            if (stashLen < length) return false;
+        }
+
+        out = PktView(stash, length);
+        if (!LooksLikePacket(out)) {
+            // Drop the first byte and hand the bytes taken from this read
+            // back to the input, so the rescan sees the stream unchanged
+            int back = inputPos - startPos < stashLen - 1 ? inputPos - startPos : stashLen - 1;
+            inputPos -= back;
+            stashLen -= 1 + back;
+            memmove(stash, stash + 1, stashLen);
+            ++droppedBytes;
+            continue;
+        }
+
+        // The bytes stay in place until the next call copies over them
+        stashDelivered = length;
+        return true;
+    }
+    return false;
+}
+
+bool PktFramer::Next(PktView& out) {
+    if (stashLen > 0) {
+        if (FillStash(out)) return true;
+        if (stashLen > 0) return false; // still waiting for the rest
+    }
+
+    while (inputPos < inputLen) {
+        const char* pkt = input + inputPos;
+        int avail = inputLen - inputPos;
+        if (avail >= HEADERSIZE) {
+            int length = static_cast<uint8_t>(pkt[3]);
+            if (length < MINPKTSIZE) {
+                ++inputPos;
+                ++droppedBytes;
+                continue;
+            }
+            if (avail >= length) {
+                out = PktView(pkt, length);
+                if (!LooksLikePacket(out)) {
+                    // A corrupted length byte: rescan from the next byte
+                    ++inputPos;
+                    ++droppedBytes;
+                    continue;
+                }
+                inputPos += length;
+                return true;
+            }
+        }
+
+        // Tail of this read is an incomplete packet: keep it for next time
+        memcpy(stash, pkt, avail);
+        stashLen = avail;
+        inputPos = inputLen;
+    }
+    return false;
+}
+
+int PktFramer::GetPartialLength() const { return stashLen - stashDelivered; }
+long PktFramer::GetDroppedBytes() const { return droppedBytes; }
+
+void PktFramer::Reset() {
+    stashLen = 0;
+    stashDelivered = 0;
+    input = nullptr;
+    inputLen = 0;
+    inputPos = 0;
+}
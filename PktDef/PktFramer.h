@@ -0,0 +1,47 @@
+#pragma once
+#include "PktDef.h"
+#include "PktView.h"
+
+// Cuts a TCP byte stream into complete packets using the header length byte.
+// A candidate whose CRC does not match, or whose flags name no single
+// command, is taken to start at a corrupted byte: the framer skips one byte
+// and rescans, so a bad length cannot swallow the packets behind it.
+// Complete packets are returned as views straight into the caller's buffer;
+// only a packet split across reads is copied (into a small internal stash).
+//
+//   framer.Feed(buf, bytes);
+//   PktView pkt;
+//   while (framer.Next(pkt)) { ... }
+//
+// A view is valid until the next call to Next or Feed, and buf must stay
+// untouched until Next returns false.
+class PktFramer {
+private:
+    char stash[MAXPKTSIZE];
+    int stashLen;
+    int stashDelivered; // leading stash bytes already handed out as a packet
+    const char* input;
+    int inputLen;
+    int inputPos;
+    long droppedBytes;
+
+    bool FillStash(PktView& out);
+
+public:
+    PktFramer();
+
+    // Hands the framer the next chunk read from the stream
+    void Feed(const char* data, int size);
+
+    // Returns the next complete packet, or false once the fed data runs out
+    bool Next(PktView& out);
+
+    // Bytes of an incomplete packet held over from earlier reads
+    int GetPartialLength() const;
+
+    // Bytes skipped because no well-formed packet started there
+    long GetDroppedBytes() const;
+
+    // Forgets any partial packet, e.g. after reconnecting
+    void Reset();
+};
@@ -0,0 +1,72 @@
+#pragma once
+#include "PktCrc.h"
+#include "PktDef.h"
+#include <cstdint>
+#include <cstring>
+
+// Largest packet a template holds: a DRIVE (header, 3-byte body, CRC)
+const int PKT_TEMPLATE_SIZE = HEADERSIZE + 3 + 1;
+
+// A packet whose bytes are all fixed except its pktCount: SLEEP, the
+// telemetry request and any DRIVE with known parameters. The frame, and the
+// CRC over everything but the pktCount, are worked out when the template is
+// built, which for a constexpr template means at compile time. Stamp then
+// copies the frame, patches in the pktCount and adds its bits to the CRC,
+// producing the same bytes as PktDef's SetCmd/CalcCRC/GenPacket.
+class PktTemplate {
+private:
+    uint8_t bytes[PKT_TEMPLATE_SIZE];
+    uint8_t length;
+    // CRC of the frame with a zero pktCount
+    uint8_t baseCrc;
+
+    constexpr PktTemplate(uint8_t flags, const uint8_t* body, int bodyLength)
+        : bytes(), length(static_cast<uint8_t>(HEADERSIZE + bodyLength + 1)), baseCrc(0) {
+        bytes[2] = flags;
+        bytes[3] = length;
+        for (int i = 0; i < bodyLength; ++i)
+            bytes[HEADERSIZE + i] = body[i];
+        unsigned count = 0;
+        for (int i = 0; i < length - 1; ++i)
+            count += CountWordBits(bytes[i]);
+        baseCrc = static_cast<uint8_t>(count);
+        bytes[length - 1] = baseCrc;
+    }
+
+public:
+    // Flag bits as PktDef::SetCmd and SetAck write them
+    static constexpr uint8_t DRIVE_FLAG = 0x01;
+    static constexpr uint8_t RESPONSE_FLAG = 0x02;
+    static constexpr uint8_t SLEEP_FLAG = 0x04;
+
+    static constexpr PktTemplate Sleep() {
+        return PktTemplate(SLEEP_FLAG, nullptr, 0);
+    }
+
+    // The empty-body RESPONSE packet that asks a robot for telemetry
+    static constexpr PktTemplate TelemetryRequest() {
+        return PktTemplate(RESPONSE_FLAG, nullptr, 0);
+    }
+
+    static constexpr PktTemplate Drive(uint8_t direction, uint8_t duration, uint8_t speed) {
+        const uint8_t body[3] = { direction, duration, speed };
+        return PktTemplate(DRIVE_FLAG, body, 3);
+    }
+
+    constexpr int GetLength() const { return length; }
+    constexpr uint8_t GetBaseCRC() const { return baseCrc; }
+
+    // Writes the packet with this pktCount into out. Returns the bytes
+    // written, or 0 if size is too small.
+    int Stamp(char* out, int size, uint16_t pktCount) const {
+        if (size < length) return 0;
+        memcpy(out, bytes, length);
+        memcpy(out, &pktCount, 2);
+        out[length - 1] = static_cast<char>(baseCrc + CountWordBits(pktCount));
+        return length;
+    }
+};
+
+// Built at compile time; only the pktCount is filled in per packet
+constexpr PktTemplate SLEEP_TEMPLATE = PktTemplate::Sleep();
+constexpr PktTemplate TELEMETRY_REQUEST_TEMPLATE = PktTemplate::TelemetryRequest();
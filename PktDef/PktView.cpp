@@ -0,0 +1,83 @@
+#include "PktView.h"
+#include "PktCrc.h"
+#include <cstring>
+
+PktView::PktView() : raw(nullptr), size(0) {}
+
+PktView::PktView(const char* rawData, int size) : raw(rawData), size(size) {}
+
+bool PktView::IsValid() const {
+    if (!raw || size < HEADERSIZE + 1) return false;
+    int length = GetLength();
+    return length >= HEADERSIZE + 1 && length <= size;
+}
+
+CmdType PktView::GetCmd() const {
+    uint8_t flags = static_cast<uint8_t>(raw[2]);
+    if (flags & 0b00000001) return CmdType::DRIVE;
+    if (flags & 0b00000010) return CmdType::RESPONSE;
+    if (flags & 0b00000100) return CmdType::SLEEP;
+    return CmdType::DRIVE; // default fallback, same as PktDef
+}
+
+bool PktView::GetAck() const {
+    return (static_cast<uint8_t>(raw[2]) & 0b00001000) != 0;
+}
+
+int PktView::GetPktCount() const {
+    uint16_t count;
+    memcpy(&count, raw, 2);
+    return count;
+}
+
+int PktView::GetLength() const {
+    return static_cast<uint8_t>(raw[3]);
+}
+
+const char* PktView::GetBodyData() const {
+    return GetBodyLength() > 0 ? raw + HEADERSIZE : nullptr;
+}
+
+int PktView::GetBodyLength() const {
+    int bodyLength = GetLength() - HEADERSIZE - 1;
+    return bodyLength > 0 ? bodyLength : 0;
+}
+
+uint8_t PktView::GetCRC() const {
+    return static_cast<uint8_t>(raw[GetLength() - 1]);
+}
+
+bool PktView::CheckCRC() const {
+    if (!IsValid()) return false;
+    return CountBits(raw, GetLength() - 1) == GetCRC();
+}
+
+DriveBody PktView::GetDriveBody() const {
+    DriveBody d = { 0, 0, 0 };
+    const char* body = GetBodyData();
+    if (body && GetBodyLength() >= 3) {
+        d.direction = body[0];
+        d.duration = body[1];
+        d.speed = body[2];
+    }
+    return d;
+}
+
+// Same 7-byte layout as PktDef::ParseTelemetry (big-endian packet counter)
+Telemetry PktView::ParseTelemetry() const {
+    Telemetry t{};
+    const uint8_t* body = reinterpret_cast<const uint8_t*>(GetBodyData());
+    if (!body || GetBodyLength() < 7) return t;
+
+    t.lastPktCounter = static_cast<uint16_t>((body[0] << 8) | body[1]);
+    t.currentGrade = body[2];
+    t.hitCount = body[3];
+    t.lastCmd = body[4];
+    t.lastCmdValue = body[5];
+    t.lastCmdSpeed = body[6];
+    return t;
+}
+
+const char* PktView::GetRaw() const {
+    return raw;
+}
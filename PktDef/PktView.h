@@ -0,0 +1,43 @@
+#pragma once
+#include "PktDef.h"
+
+// Non-owning, read-only view of a serialized packet. Parses the header, body
+// and CRC in place over a caller-owned buffer without allocating or copying;
+// the buffer must stay alive and unchanged while the view is in use.
+class PktView {
+private:
+    const char* raw;
+    int size;
+
+public:
+    // Empty view; IsValid() is false
+    PktView();
+
+    // Views the packet at the start of rawData (size = bytes available)
+    PktView(const char* rawData, int size);
+
+    // True when the buffer holds a complete packet as declared by its length byte
+    bool IsValid() const;
+
+    CmdType GetCmd() const;
+    bool GetAck() const;
+    int GetPktCount() const;
+
+    // Total packet length (header + body + CRC) from the length byte
+    int GetLength() const;
+
+    // Pointer into the viewed buffer, or nullptr if the body is empty
+    const char* GetBodyData() const;
+    int GetBodyLength() const;
+
+    uint8_t GetCRC() const;
+
+    // Recounts the bits over header + body and compares with the CRC byte
+    bool CheckCRC() const;
+
+    DriveBody GetDriveBody() const;
+    Telemetry ParseTelemetry() const;
+
+    // Start of the viewed packet
+    const char* GetRaw() const;
+};
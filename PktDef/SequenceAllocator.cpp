@@ -0,0 +1,71 @@
+#include "SequenceAllocator.h"
+
+SequenceAllocator::SequenceAllocator() : SequenceAllocator(1) {}
+
+SequenceAllocator::SequenceAllocator(uint16_t first) : next(first), outstandingCount(0) {
+    for (std::atomic<uint64_t>& word : outstanding)
+        word.store(0, std::memory_order_relaxed);
+}
+
+// Sets the ID's outstanding bit; false if another packet already holds it
+bool SequenceAllocator::TryMark(uint16_t id) {
+    uint64_t bit = 1ULL << (id & 63);
+    uint64_t previous = outstanding[id >> 6].fetch_or(bit, std::memory_order_acq_rel);
+    if (previous & bit) return false;
+    outstandingCount.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+int SequenceAllocator::Next() {
+    for (int attempt = 0; attempt < SEQUENCE_SPACE; ++attempt) {
+        // 2^32 is a multiple of 2^16, so truncating keeps the wrap seamless
+        uint16_t id = static_cast<uint16_t>(next.fetch_add(1, std::memory_order_relaxed));
+        if (!IsOutstanding(id)) return id;
+    }
+    return -1;
+}
+
+int SequenceAllocator::Acquire() {
+    for (int attempt = 0; attempt < SEQUENCE_SPACE; ++attempt) {
+        uint16_t id = static_cast<uint16_t>(next.fetch_add(1, std::memory_order_relaxed));
+        if (TryMark(id)) return id;
+    }
+    return -1;
+}
+
+int SequenceAllocator::AcquireBlock(uint16_t* ids, int count) {
+    if (count <= 0) return 0;
+    if (count > SEQUENCE_SPACE) count = SEQUENCE_SPACE;
+
+    int taken = 0;
+    uint32_t first = next.fetch_add(static_cast<uint32_t>(count), std::memory_order_relaxed);
+    for (int i = 0; i < count; ++i) {
+        uint16_t id = static_cast<uint16_t>(first + i);
+        if (TryMark(id)) ids[taken++] = id;
+    }
+
+    // Make up for any IDs that were still waiting on a reply
+    while (taken < count) {
+        int id = Acquire();
+        if (id < 0) break;
+        ids[taken++] = static_cast<uint16_t>(id);
+    }
+    return taken;
+}
+
+void SequenceAllocator::Release(int id) {
+    uint16_t key = static_cast<uint16_t>(id);
+    uint64_t bit = 1ULL << (key & 63);
+    uint64_t previous = outstanding[key >> 6].fetch_and(~bit, std::memory_order_acq_rel);
+    if (previous & bit)
+        outstandingCount.fetch_sub(1, std::memory_order_relaxed);
+}
+
+bool SequenceAllocator::IsOutstanding(int id) const {
+    uint16_t key = static_cast<uint16_t>(id);
+    return (outstanding[key >> 6].load(std::memory_order_acquire) >> (key & 63)) & 1;
+}
+
+int SequenceAllocator::GetOutstandingCount() const {
+    return outstandingCount.load(std::memory_order_relaxed);
+}
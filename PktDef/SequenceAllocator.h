@@ -0,0 +1,41 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+// Header::pktCount is 16 bits, so sequence numbers wrap after 65535
+const int SEQUENCE_SPACE = 65536;
+
+// Hands out packet sequence numbers to any number of threads with a single
+// atomic add per packet. Numbers wrap at 16 bits like the header field.
+// IDs taken with Acquire stay outstanding until Release; while a number is
+// outstanding it is skipped on the next lap, so a late ACK after wraparound
+// can never be matched to a newer packet.
+class SequenceAllocator {
+private:
+    std::atomic<uint32_t> next;
+    std::atomic<uint64_t> outstanding[SEQUENCE_SPACE / 64];
+    std::atomic<int> outstandingCount;
+
+    bool TryMark(uint16_t id);
+
+public:
+    SequenceAllocator();
+    explicit SequenceAllocator(uint16_t first);
+
+    // Untracked number for fire-and-forget packets; -1 if every ID is outstanding
+    int Next();
+
+    // Tracked number for a packet that expects a reply; -1 if none is free
+    int Acquire();
+
+    // Tracked numbers for a batch, taken with one atomic add. They are
+    // consecutive unless some were still outstanding. Returns how many
+    // were written to ids.
+    int AcquireBlock(uint16_t* ids, int count);
+
+    // The reply arrived (or its deadline passed); the ID may be reused
+    void Release(int id);
+
+    bool IsOutstanding(int id) const;
+    int GetOutstandingCount() const;
+};
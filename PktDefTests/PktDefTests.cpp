@@ -1,6 +1,18 @@
 ﻿#include "pch.h"
 #include "CppUnitTest.h"
 #include "../PktDef/PktDef.h"
+#include "../PktDef/PktView.h"
+#include "../PktDef/PktCrc.h"
+#include "../PktDef/PktFramer.h"
+#include "../PktDef/SequenceAllocator.h"
+#include "../PktDef/DuplicateFilter.h"
+#include "../PktDef/PacketPool.h"
+#include "../PktDef/PktTemplate.h"
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
@@ -402,5 +414,701 @@ namespace PktDefTests
             Assert::AreEqual(42, pkt.GetPktCount());
         }
        
+        // Raw buffer constructor copies the body that follows the 4-byte header.
+        TEST_METHOD(Test26_RawBuffer_BodyStartsAfterHeader)
+        {
+            // Arrange
+            char buffer[8] = { 0x01, 0x00, 0x01, 0x08, 0x02, 0x0A, 0x50, 0x0A };
+
+            // Act
+            PktDef pkt(buffer);
+            DriveBody body = pkt.GetDriveBody();
+
+            // Assert
+            Assert::AreEqual(BACKWARD, (int)body.direction);
+            Assert::AreEqual(10, (int)body.duration);
+            Assert::AreEqual(80, (int)body.speed);
+        }
+
+        // PktView reads header fields in place from a raw buffer.
+        TEST_METHOD(Test27_PktView_ParsesHeaderInPlace)
+        {
+            // Arrange
+            char buffer[9] = { 0x7B, 0x00, 0x09, 0x09, 0x00, 0x01, 0x05, 0x5A, 0x11 };
+
+            // Act
+            PktView view(buffer, sizeof(buffer));
+
+            // Assert
+            Assert::IsTrue(view.IsValid());
+            Assert::AreEqual(123, view.GetPktCount());
+            Assert::AreEqual(9, view.GetLength());
+            Assert::IsTrue(view.GetAck());
+            Assert::IsTrue(view.GetCmd() == CmdType::DRIVE);
+        }
+
+        // PktView body pointer aliases the caller's buffer instead of copying.
+        TEST_METHOD(Test28_PktView_BodyPointsIntoBuffer)
+        {
+            // Arrange
+            char buffer[8] = { 0x01, 0x00, 0x01, 0x08, 0x01, 0x05, 0x5A, 0x00 };
+
+            // Act
+            PktView view(buffer, sizeof(buffer));
+
+            // Assert
+            Assert::IsTrue(view.GetBodyData() == buffer + HEADERSIZE);
+            Assert::AreEqual(3, view.GetBodyLength());
+            Assert::AreEqual(90, (int)view.GetDriveBody().speed);
+        }
+
+        // PktView accepts a packet serialized by PktDef and rejects a corrupted CRC.
+        TEST_METHOD(Test29_PktView_CheckCRC_MatchesPktDef)
+        {
+            // Arrange
+            PktDef pkt;
+            pkt.SetCmd(CmdType::DRIVE);
+            pkt.SetPktCount(77);
+            pkt.SetDriveBody(RIGHT, 20, 60);
+            pkt.CalcCRC();
+            char* raw = pkt.GenPacket();
+
+            // Act
+            PktView good(raw, pkt.GetLength());
+            bool before = good.CheckCRC();
+            raw[pkt.GetLength() - 1] ^= 0x01;
+            bool after = good.CheckCRC();
+
+            // Assert
+            Assert::IsTrue(before);
+            Assert::IsFalse(after);
+        }
+
+        // PktView is invalid when the buffer is shorter than the declared length.
+        TEST_METHOD(Test30_PktView_TruncatedBuffer_IsInvalid)
+        {
+            // Arrange
+            char buffer[6] = { 0x01, 0x00, 0x02, 0x0C, 0x00, 0x2A };
+
+            // Act
+            PktView view(buffer, sizeof(buffer));
+            PktView empty;
+
+            // Assert
+            Assert::IsFalse(view.IsValid());
+            Assert::IsFalse(view.CheckCRC());
+            Assert::IsFalse(empty.IsValid());
+        }
+
+        // PktView decodes the 7-byte telemetry body, including counters above 0x7F.
+        TEST_METHOD(Test31_PktView_ParsesTelemetry)
+        {
+            // Arrange
+            char buffer[12] = { 0x05, 0x00, 0x0A, 0x0C,
+                                0x01, (char)0x90, 0x64, 0x02, 0x01, 0x0A, 0x5A,
+                                0x00 };
+
+            // Act
+            Telemetry t = PktView(buffer, sizeof(buffer)).ParseTelemetry();
+
+            // Assert
+            Assert::AreEqual(400, (int)t.lastPktCounter);
+            Assert::AreEqual(100, (int)t.currentGrade);
+            Assert::AreEqual(2, (int)t.hitCount);
+            Assert::AreEqual(1, (int)t.lastCmd);
+            Assert::AreEqual(10, (int)t.lastCmdValue);
+            Assert::AreEqual(90, (int)t.lastCmdSpeed);
+        }
+
+        // SerializeInto writes exactly the bytes GenPacket produces.
+        TEST_METHOD(Test32_SerializeInto_MatchesGenPacket)
+        {
+            // Arrange
+            PktDef pkt;
+            pkt.SetCmd(CmdType::DRIVE);
+            pkt.SetPktCount(500);
+            pkt.SetDriveBody(FORWARD, 5, 80);
+            pkt.CalcCRC();
+            char out[MAXPKTSIZE] = {};
+
+            // Act
+            int written = pkt.SerializeInto(out, sizeof(out));
+            char* raw = pkt.GenPacket();
+
+            // Assert
+            Assert::AreEqual(pkt.GetLength(), written);
+            Assert::IsTrue(memcmp(out, raw, written) == 0);
+        }
+
+        // SerializeInto refuses a buffer that cannot hold the whole packet.
+        TEST_METHOD(Test33_SerializeInto_BufferTooSmall_ReturnsZero)
+        {
+            // Arrange
+            PktDef pkt;
+            pkt.SetDriveBody(FORWARD, 5, 80);
+            pkt.CalcCRC();
+            char out[4] = {};
+
+            // Act
+            int written = pkt.SerializeInto(out, sizeof(out));
+
+            // Assert
+            Assert::AreEqual(0, written);
+        }
+
+        // A maximum-size body fits the 8-bit length field and round-trips.
+        TEST_METHOD(Test34_SetBodyData_MaxBody_RoundTrips)
+        {
+            // Arrange
+            char body[MAXBODYSIZE];
+            for (int i = 0; i < MAXBODYSIZE; ++i) body[i] = (char)i;
+            PktDef pkt;
+            pkt.SetCmd(CmdType::RESPONSE);
+            pkt.SetBodyData(body, MAXBODYSIZE);
+            pkt.CalcCRC();
+
+            // Act
+            PktDef copy(pkt.GenPacket());
+
+            // Assert
+            Assert::AreEqual(MAXPKTSIZE, pkt.GetLength());
+            Assert::IsTrue(memcmp(body, copy.GetBodyData(), MAXBODYSIZE) == 0);
+            Assert::AreEqual((int)pkt.GetCRC(), (int)copy.GetCRC());
+        }
+
+        // Every CRC kernel matches the original bit loop for all body sizes 0..250.
+        TEST_METHOD(Test35_CrcKernels_BitExactForAllBodySizes)
+        {
+            // Arrange
+            char buffer[MAXPKTSIZE];
+            unsigned seed = 12345;
+            for (int i = 0; i < MAXPKTSIZE; ++i) {
+                seed = seed * 1103515245 + 12345;
+                buffer[i] = (char)(seed >> 16);
+            }
+
+            for (int body = 0; body <= MAXBODYSIZE; ++body) {
+                // Act
+                int size = HEADERSIZE + body;
+                uint8_t expected = CountBitsLoop(buffer, size);
+
+                // Assert
+                Assert::AreEqual((int)expected, (int)CountBitsTable(buffer, size));
+                Assert::AreEqual((int)expected, (int)CountBitsPopcnt(buffer, size));
+                Assert::AreEqual((int)expected, (int)CountBitsAVX2(buffer, size));
+                Assert::AreEqual((int)expected, (int)CountBits(buffer, size));
+            }
+        }
+
+        // All-ones buffers overflow the 8-bit count the same way in every kernel.
+        TEST_METHOD(Test36_CrcKernels_WrapModulo256)
+        {
+            // Arrange
+            char buffer[MAXPKTSIZE];
+            memset(buffer, 0xFF, sizeof(buffer));
+
+            // Act
+            uint8_t expected = CountBitsLoop(buffer, MAXPKTSIZE - 1);
+
+            // Assert
+            Assert::AreEqual((int)(uint8_t)((MAXPKTSIZE - 1) * 8), (int)expected);
+            Assert::AreEqual((int)expected, (int)CountBitsAVX2(buffer, MAXPKTSIZE - 1));
+            Assert::AreEqual((int)expected, (int)CountBits(buffer, MAXPKTSIZE - 1));
+        }
+
+        // Two packets coalesced into one read come out as two views into that buffer.
+        TEST_METHOD(Test37_PktFramer_CoalescedPackets_SplitIntoViews)
+        {
+            // Arrange
+            PktDef a, b;
+            a.SetCmd(CmdType::DRIVE); a.SetPktCount(1); a.SetDriveBody(FORWARD, 5, 80); a.CalcCRC();
+            b.SetCmd(CmdType::SLEEP); b.SetPktCount(2); b.SetBodyData(nullptr, 0); b.CalcCRC();
+            char stream[64];
+            int len = a.SerializeInto(stream, sizeof(stream));
+            len += b.SerializeInto(stream + len, sizeof(stream) - len);
+            PktFramer framer;
+            PktView first, second, none;
+
+            // Act
+            framer.Feed(stream, len);
+            bool gotFirst = framer.Next(first);
+            bool gotSecond = framer.Next(second);
+            bool gotThird = framer.Next(none);
+
+            // Assert
+            Assert::IsTrue(gotFirst && gotSecond);
+            Assert::IsFalse(gotThird);
+            Assert::IsTrue(first.GetRaw() == stream);
+            Assert::AreEqual(1, first.GetPktCount());
+            Assert::AreEqual(2, second.GetPktCount());
+            Assert::IsTrue(second.CheckCRC());
+        }
+
+        // A packet delivered one byte per read is reassembled across reads.
+        TEST_METHOD(Test38_PktFramer_SplitPacket_ReassembledAcrossReads)
+        {
+            // Arrange
+            PktDef pkt;
+            pkt.SetCmd(CmdType::DRIVE); pkt.SetPktCount(300); pkt.SetDriveBody(LEFT, 9, 70); pkt.CalcCRC();
+            char* raw = pkt.GenPacket();
+            PktFramer framer;
+            PktView view;
+            int completed = 0;
+
+            // Act
+            for (int i = 0; i < pkt.GetLength(); ++i) {
+                framer.Feed(raw + i, 1);
+                while (framer.Next(view)) ++completed;
+            }
+
+            // Assert
+            Assert::AreEqual(1, completed);
+            Assert::AreEqual(300, view.GetPktCount());
+            Assert::AreEqual(LEFT, (int)view.GetDriveBody().direction);
+            Assert::IsTrue(view.CheckCRC());
+            Assert::AreEqual(0, framer.GetPartialLength());
+        }
+
+        // Bytes whose length field cannot start a packet are skipped to resynchronize.
+        TEST_METHOD(Test39_PktFramer_BadLength_SkipsGarbage)
+        {
+            // Arrange
+            char stream[7] = { 0x01, 0x02,                     // garbage
+                               0x07, 0x00, 0x04, 0x05, 0x06 }; // SLEEP, count 7
+            PktFramer framer;
+            PktView view;
+
+            // Act
+            framer.Feed(stream, sizeof(stream));
+            bool got = framer.Next(view);
+
+            // Assert
+            Assert::IsTrue(got);
+            Assert::AreEqual(7, view.GetPktCount());
+            Assert::IsTrue(view.GetCmd() == CmdType::SLEEP);
+            Assert::AreEqual(2L, framer.GetDroppedBytes());
+        }
+
+        // Sequence numbers wrap from 65535 back to 0 like the 16-bit header field.
+        TEST_METHOD(Test40_SequenceAllocator_WrapsAt16Bits)
+        {
+            // Arrange
+            SequenceAllocator seq(65534);
+
+            // Act
+            int a = seq.Next();
+            int b = seq.Next();
+            int c = seq.Next();
+
+            // Assert
+            Assert::AreEqual(65534, a);
+            Assert::AreEqual(65535, b);
+            Assert::AreEqual(0, c);
+        }
+
+        // An ID still awaiting its ACK is skipped on the next lap instead of reused.
+        TEST_METHOD(Test41_SequenceAllocator_SkipsOutstandingAfterWrap)
+        {
+            // Arrange
+            SequenceAllocator seq(65535);
+            int held = seq.Acquire();
+            int released = seq.Acquire();
+            seq.Release(released);
+
+            // Act
+            for (int i = 0; i < SEQUENCE_SPACE - 2; ++i) seq.Next();
+            int next = seq.Acquire();
+            int after = seq.Acquire();
+
+            // Assert
+            Assert::AreEqual(65535, held);
+            Assert::AreEqual(0, released);
+            Assert::AreEqual(0, next);
+            Assert::AreEqual(1, after);
+            Assert::IsTrue(seq.IsOutstanding(65535));
+            Assert::AreEqual(3, seq.GetOutstandingCount());
+        }
+
+        // A block reservation is consecutive and marks every ID outstanding.
+        TEST_METHOD(Test42_SequenceAllocator_AcquireBlock_Consecutive)
+        {
+            // Arrange
+            SequenceAllocator seq(100);
+            uint16_t ids[8];
+
+            // Act
+            int taken = seq.AcquireBlock(ids, 8);
+            int following = seq.Next();
+
+            // Assert
+            Assert::AreEqual(8, taken);
+            for (int i = 0; i < 8; ++i) {
+                Assert::AreEqual(100 + i, static_cast<int>(ids[i]));
+                Assert::IsTrue(seq.IsOutstanding(ids[i]));
+            }
+            Assert::AreEqual(108, following);
+            Assert::AreEqual(8, seq.GetOutstandingCount());
+        }
+
+        // A block that runs into outstanding IDs skips them and still fills up.
+        TEST_METHOD(Test43_SequenceAllocator_AcquireBlock_SkipsOutstanding)
+        {
+            // Arrange
+            SequenceAllocator seq(10);
+            int held = seq.Acquire();            // 10 stays outstanding
+            for (int i = 0; i < SEQUENCE_SPACE - 1; ++i) seq.Next();
+            uint16_t ids[4];
+
+            // Act
+            int taken = seq.AcquireBlock(ids, 4);
+
+            // Assert
+            Assert::AreEqual(10, held);
+            Assert::AreEqual(4, taken);
+            for (int i = 0; i < 4; ++i)
+                Assert::AreNotEqual(10, static_cast<int>(ids[i]));
+            Assert::AreEqual(5, seq.GetOutstandingCount());
+        }
+
+        // Threads acquiring at the same time never get the same ID.
+        TEST_METHOD(Test44_SequenceAllocator_ConcurrentAcquire_Unique)
+        {
+            // Arrange
+            SequenceAllocator seq;
+            const int THREADS = 4;
+            const int PER_THREAD = 5000;
+            std::vector<int> got[THREADS];
+            std::vector<std::thread> workers;
+
+            // Act
+            for (int t = 0; t < THREADS; ++t) {
+                workers.emplace_back([&seq, &got, t]() {
+                    for (int i = 0; i < PER_THREAD; ++i) got[t].push_back(seq.Acquire());
+                    });
+            }
+            for (std::thread& w : workers) w.join();
+
+            // Assert
+            std::vector<bool> seen(SEQUENCE_SPACE, false);
+            for (int t = 0; t < THREADS; ++t) {
+                for (int id : got[t]) {
+                    Assert::IsTrue(id >= 0);
+                    Assert::IsFalse(seen[id]);
+                    seen[id] = true;
+                }
+            }
+            Assert::AreEqual(THREADS * PER_THREAD, seq.GetOutstandingCount());
+        }
+
+        // A repeated pktCount gets back exactly the reply recorded for it.
+        TEST_METHOD(Test45_DuplicateFilter_Repeat_ReturnsCachedReply)
+        {
+            // Arrange
+            DuplicateFilter seen;
+            char ack[] = { 0x07, 0x00, 0x09, 0x05, 0x04 };
+            int length = 0;
+
+            // Act
+            const char* before = seen.Find(7, length);
+            seen.Remember(7, ack, sizeof(ack));
+            const char* after = seen.Find(7, length);
+
+            // Assert
+            Assert::IsNull(before);
+            Assert::IsNotNull(after);
+            Assert::AreEqual((int)sizeof(ack), length);
+            Assert::AreEqual(0, memcmp(ack, after, sizeof(ack)));
+        }
+
+        // Once DEDUPE_HISTORY newer counts have been seen, an old one is new again.
+        TEST_METHOD(Test46_DuplicateFilter_OldCount_Forgotten)
+        {
+            // Arrange
+            DuplicateFilter seen;
+            char ack[] = { 0x01 };
+            int length = 0;
+
+            // Act
+            seen.Remember(5, ack, 1);
+            for (int id = 6; id < 6 + DEDUPE_HISTORY; ++id)
+                seen.Remember(id, ack, 1);
+
+            // Assert
+            Assert::IsNull(seen.Find(5, length));
+            Assert::IsNotNull(seen.Find(5 + DEDUPE_HISTORY, length));
+        }
+
+        // Neighbouring counts keep their own replies.
+        TEST_METHOD(Test47_DuplicateFilter_Counts_Independent)
+        {
+            // Arrange
+            DuplicateFilter seen;
+            char first[] = { 0x11, 0x12 };
+            char second[] = { 0x21, 0x22, 0x23 };
+            int firstLength = 0, secondLength = 0;
+
+            // Act
+            seen.Remember(1, first, sizeof(first));
+            seen.Remember(2, second, sizeof(second));
+            const char* a = seen.Find(1, firstLength);
+            const char* b = seen.Find(2, secondLength);
+
+            // Assert
+            Assert::AreEqual(2, firstLength);
+            Assert::AreEqual(3, secondLength);
+            Assert::AreEqual(0, memcmp(first, a, sizeof(first)));
+            Assert::AreEqual(0, memcmp(second, b, sizeof(second)));
+            Assert::IsNull(seen.Find(3, firstLength));
+        }
+
+        // A released block is handed straight back to the same thread.
+        TEST_METHOD(Test48_PacketPool_Release_ReusesBlock)
+        {
+            // Arrange
+            char* first = PacketPool::Acquire();
+            uint64_t hitsBefore = PacketPool::GetHits();
+
+            // Act
+            PacketPool::Release(first);
+            char* second = PacketPool::Acquire();
+
+            // Assert
+            Assert::IsTrue(first == second);
+            Assert::IsTrue(PacketPool::GetHits() == hitsBefore + 1);
+            PacketPool::Release(second);
+        }
+
+        // A PacketBuffer holds a copy of the bytes; moving it leaves the source empty.
+        TEST_METHOD(Test49_PacketBuffer_CopyAndMove)
+        {
+            // Arrange
+            char raw[] = { 0x01, 0x00, 0x02, 0x05, 0x7F };
+
+            // Act
+            PacketBuffer original(raw, sizeof(raw));
+            raw[0] = 0x00;
+            PacketBuffer moved(std::move(original));
+
+            // Assert
+            Assert::IsTrue(original.empty());
+            Assert::AreEqual(5, static_cast<int>(moved.size()));
+            Assert::AreEqual(static_cast<char>(0x01), moved.data()[0]);
+            Assert::AreEqual(0, memcmp(raw + 1, moved.data() + 1, sizeof(raw) - 1));
+            Assert::IsTrue(PacketBuffer().empty());
+        }
+
+        // Blocks released on another thread can be acquired again without corruption.
+        TEST_METHOD(Test50_PacketPool_CrossThreadRelease)
+        {
+            // Arrange
+            const int COUNT = 3 * PACKET_CACHE_BLOCKS;
+            std::vector<char*> blocks;
+            for (int i = 0; i < COUNT; ++i) {
+                blocks.push_back(PacketPool::Acquire());
+                memset(blocks.back(), i & 0xFF, PACKET_BLOCK_SIZE);
+            }
+
+            // Act
+            std::thread releaser([&blocks]() {
+                for (char* block : blocks) PacketPool::Release(block);
+                });
+            releaser.join();
+            std::vector<char*> again;
+            for (int i = 0; i < COUNT; ++i) again.push_back(PacketPool::Acquire());
+
+            // Assert
+            std::sort(again.begin(), again.end());
+            Assert::IsTrue(std::adjacent_find(again.begin(), again.end()) == again.end());
+            for (char* block : again) PacketPool::Release(block);
+        }
+
+        // A stamped SLEEP or telemetry request matches the PktDef-built packet byte for byte.
+        TEST_METHOD(Test51_PktTemplate_FixedCommands_MatchPktDef)
+        {
+            // Arrange
+            static_assert(SLEEP_TEMPLATE.GetLength() == HEADERSIZE + 1, "built at compile time");
+            const int counts[] = { 0, 1, 0x00FF, 0x0100, 0x7A5C, 0xFFFF };
+            char stamped[PKT_TEMPLATE_SIZE];
+
+            for (int count : counts) {
+                PktDef sleep;
+                sleep.SetCmd(CmdType::SLEEP);
+                sleep.SetAck(false);
+                sleep.SetPktCount(count);
+                sleep.SetBodyData(nullptr, 0);
+                sleep.CalcCRC();
+                PktDef request;
+                request.SetCmd(CmdType::RESPONSE);
+                request.SetAck(false);
+                request.SetPktCount(count);
+                request.SetBodyData(nullptr, 0);
+                request.CalcCRC();
+
+                // Act
+                int sleepLength = SLEEP_TEMPLATE.Stamp(stamped, sizeof(stamped), static_cast<uint16_t>(count));
+
+                // Assert
+                Assert::AreEqual(sleep.GetLength(), sleepLength);
+                Assert::AreEqual(0, memcmp(sleep.GenPacket(), stamped, sleepLength));
+                int requestLength = TELEMETRY_REQUEST_TEMPLATE.Stamp(stamped, sizeof(stamped), static_cast<uint16_t>(count));
+                Assert::AreEqual(request.GetLength(), requestLength);
+                Assert::AreEqual(0, memcmp(request.GenPacket(), stamped, requestLength));
+            }
+        }
+
+        // A DRIVE template matches PktDef for every direction, and fails cleanly when out is too small.
+        TEST_METHOD(Test52_PktTemplate_Drive_MatchesPktDef)
+        {
+            // Arrange
+            constexpr PktTemplate forward = PktTemplate::Drive(FORWARD, 5, 80);
+            static_assert(forward.GetLength() == PKT_TEMPLATE_SIZE, "built at compile time");
+            char stamped[PKT_TEMPLATE_SIZE];
+
+            for (int dir = FORWARD; dir <= LEFT; ++dir) {
+                PktDef drive;
+                drive.SetCmd(CmdType::DRIVE);
+                drive.SetAck(false);
+                drive.SetPktCount(0xBEEF);
+                drive.SetDriveBody(static_cast<uint8_t>(dir), 7, 95);
+                drive.CalcCRC();
+
+                // Act
+                int length = PktTemplate::Drive(static_cast<uint8_t>(dir), 7, 95).Stamp(stamped, sizeof(stamped), 0xBEEF);
+
+                // Assert
+                Assert::AreEqual(drive.GetLength(), length);
+                Assert::AreEqual(0, memcmp(drive.GenPacket(), stamped, length));
+            }
+            Assert::AreEqual(0, forward.Stamp(stamped, PKT_TEMPLATE_SIZE - 1, 1));
+        }
+
+        // Random runs of UpdatePktCount and UpdateAck on random packets always leave the CRC CalcCRC would compute.
+        TEST_METHOD(Test53_PktDef_IncrementalCRC_MatchesFullRecompute)
+        {
+            // Arrange
+            std::mt19937 rng(2025);
+            const CmdType cmds[] = { CmdType::DRIVE, CmdType::SLEEP, CmdType::RESPONSE };
+            char body[MAXBODYSIZE];
+
+            for (int packetNo = 0; packetNo < 500; ++packetNo) {
+                int bodyLength = static_cast<int>(rng() % (MAXBODYSIZE + 1));
+                for (int i = 0; i < bodyLength; ++i) body[i] = static_cast<char>(rng());
+                PktDef packet;
+                packet.SetCmd(cmds[rng() % 3]);
+                packet.SetAck(rng() % 2 == 0);
+                packet.SetPktCount(static_cast<int>(rng() & 0xFFFF));
+                packet.SetBodyData(body, bodyLength);
+                packet.CalcCRC();
+
+                for (int step = 0; step < 50; ++step) {
+                    // Act
+                    if (rng() % 4 == 0)
+                        packet.UpdateAck(rng() % 2 == 0);
+                    else
+                        packet.UpdatePktCount(static_cast<int>(rng() & 0xFFFF));
+
+                    // Assert
+                    PktDef recomputed = packet;
+                    recomputed.CalcCRC();
+                    Assert::AreEqual(static_cast<int>(recomputed.GetCRC()), static_cast<int>(packet.GetCRC()));
+                }
+                Assert::IsTrue(packet.CheckCRC(packet.GenPacket(), packet.GetLength()));
+            }
+        }
+
+        // The incremental setters wrap the CRC mod 256 and leave it alone when nothing changes.
+        TEST_METHOD(Test54_PktDef_IncrementalCRC_WrapsAndNoOps)
+        {
+            // Arrange: 32 bytes of 0xFF put the CRC right at the wrap
+            char ones[32];
+            memset(ones, 0xFF, sizeof(ones));
+            PktDef packet;
+            packet.SetCmd(CmdType::DRIVE);
+            packet.SetAck(false);
+            packet.SetPktCount(0);
+            packet.SetBodyData(ones, sizeof(ones));
+            packet.CalcCRC();
+            int before = packet.GetCRC();
+
+            // Act
+            packet.UpdateAck(false);
+            packet.UpdatePktCount(0);
+            int unchanged = packet.GetCRC();
+            packet.UpdatePktCount(0xFFFF);
+            packet.UpdateAck(true);
+
+            // Assert
+            Assert::AreEqual(before, unchanged);
+            Assert::AreEqual(0xFFFF, packet.GetPktCount());
+            Assert::IsTrue(packet.GetAck());
+            Assert::IsTrue(packet.CheckCRC(packet.GenPacket(), packet.GetLength()));
+            packet.UpdateAck(false);
+            packet.UpdatePktCount(0);
+            Assert::AreEqual(before, static_cast<int>(packet.GetCRC()));
+        }
+
+        // A corrupted length of 5 or more fails the CRC, so the framer rescans and keeps the packets behind it.
+        TEST_METHOD(Test55_PktFramer_CorruptedLength_ResyncsOnCRC)
+        {
+            // Arrange
+            char stream[256];
+            int len = BuildCorruptedStream(stream, sizeof(stream), 20);
+            PktFramer framer;
+            PktView view;
+            int next = 2;
+            bool inOrder = true;
+
+            // Act
+            framer.Feed(stream, len);
+            while (framer.Next(view)) inOrder = inOrder && view.GetPktCount() == next++;
+
+            // Assert
+            Assert::IsTrue(inOrder);
+            Assert::AreEqual(18, next);
+            Assert::AreEqual(8L, framer.GetDroppedBytes());
+        }
+
+        // The same resync works when the corrupted packet is split across reads.
+        TEST_METHOD(Test56_PktFramer_CorruptedLength_ResyncsAcrossReads)
+        {
+            // Arrange
+            char stream[256];
+            int len = BuildCorruptedStream(stream, sizeof(stream), 5);
+            PktFramer framer;
+            PktView view;
+            int next = 2;
+            bool inOrder = true;
+
+            // Act
+            for (int i = 0; i < len; i += 3) {
+                framer.Feed(stream + i, len - i < 3 ? len - i : 3);
+                while (framer.Next(view)) inOrder = inOrder && view.GetPktCount() == next++;
+            }
+
+            // Assert
+            Assert::IsTrue(inOrder);
+            Assert::AreEqual(18, next);
+            Assert::AreEqual(0, framer.GetPartialLength());
+        }
+
+    private:
+        // A DRIVE (count 1) whose length byte is overwritten with badLength,
+        // followed by 16 valid DRIVEs and SLEEPs counting up from 2
+        static int BuildCorruptedStream(char* stream, int size, int badLength)
+        {
+            PktDef first;
+            first.SetCmd(CmdType::DRIVE); first.SetPktCount(1); first.SetDriveBody(FORWARD, 5, 80); first.CalcCRC();
+            int len = first.SerializeInto(stream, size);
+            for (int i = 0; i < 16; ++i) {
+                PktDef pkt;
+                pkt.SetPktCount(2 + i);
+                if (i % 2 == 0) { pkt.SetCmd(CmdType::DRIVE); pkt.SetDriveBody(LEFT, 9, 70); }
+                else { pkt.SetCmd(CmdType::SLEEP); pkt.SetBodyData(nullptr, 0); }
+                pkt.CalcCRC();
+                len += pkt.SerializeInto(stream + len, size - len);
+            }
+            stream[3] = static_cast<char>(badLength);
+            return len;
+        }
     };
 }
\ No newline at end of file
@@ -0,0 +1,244 @@
+#include "AssetCache.h"
+#include "Logger.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#ifdef ASSETCACHE_GZIP
+#include <zlib.h>
+#endif
+#ifdef ASSETCACHE_BROTLI
+#include <brotli/encode.h>
+#endif
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// Files smaller than this gain nothing from compression once headers are counted
+const size_t MIN_COMPRESS_SIZE = 256;
+
+// 64-bit FNV-1a, formatted as a quoted ETag
+static std::string MakeETag(const std::string& data, const char* suffix) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    char buf[40];
+    std::snprintf(buf, sizeof(buf), "\"%016llx%s\"", static_cast<unsigned long long>(hash), suffix);
+    return buf;
+}
+
+static std::string ContentTypeFor(const std::string& name) {
+    static const std::unordered_map<std::string, std::string> types = {
+        { ".html", "text/html" },
+        { ".css", "text/css" },
+        { ".js", "application/javascript" },
+        { ".json", "application/json" },
+        { ".svg", "image/svg+xml" },
+        { ".png", "image/png" },
+        { ".ico", "image/x-icon" },
+        { ".txt", "text/plain" },
+    };
+    size_t dot = name.rfind('.');
+    if (dot != std::string::npos) {
+        auto it = types.find(name.substr(dot));
+        if (it != types.end()) return it->second;
+    }
+    return "application/octet-stream";
+}
+
+static std::string Gzip(const std::string& data) {
+#ifdef ASSETCACHE_GZIP
+    z_stream zs = {};
+    // 15 + 16 selects the gzip wrapper rather than raw zlib
+    if (deflateInit2(&zs, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK)
+        return std::string();
+    std::string out(deflateBound(&zs, static_cast<uLong>(data.size())), '\0');
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    zs.avail_in = static_cast<uInt>(data.size());
+    zs.next_out = reinterpret_cast<Bytef*>(&out[0]);
+    zs.avail_out = static_cast<uInt>(out.size());
+    int rc = deflate(&zs, Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return rc == Z_STREAM_END ? out : std::string();
+#else
+    (void)data;
+    return std::string();
+#endif
+}
+
+static std::string Brotli(const std::string& data) {
+#ifdef ASSETCACHE_BROTLI
+    size_t size = BrotliEncoderMaxCompressedSize(data.size());
+    if (size == 0) return std::string();
+    std::string out(size, '\0');
+    if (!BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT,
+        data.size(), reinterpret_cast<const uint8_t*>(data.data()),
+        &size, reinterpret_cast<uint8_t*>(&out[0])))
+        return std::string();
+    out.resize(size);
+    return out;
+#else
+    (void)data;
+    return std::string();
+#endif
+}
+
+// Splits a comma-separated header and calls fn on each trimmed element
+template <typename Fn>
+static void ForEachToken(const std::string& header, Fn fn) {
+    size_t pos = 0;
+    while (pos <= header.size()) {
+        size_t end = header.find(',', pos);
+        if (end == std::string::npos) end = header.size();
+        size_t first = header.find_first_not_of(" \t", pos);
+        size_t last = header.find_last_not_of(" \t", end - 1);
+        if (first < end && last != std::string::npos && last >= first)
+            fn(header.substr(first, last - first + 1));
+        pos = end + 1;
+    }
+}
+
+// True if Accept-Encoding names coding (or *) without q=0
+static bool Accepts(const std::string& acceptEncoding, const char* coding) {
+    bool accepted = false;
+    ForEachToken(acceptEncoding, [&](const std::string& token) {
+        size_t semi = token.find(';');
+        std::string name = token.substr(0, semi);
+        while (!name.empty() && (name.back() == ' ' || name.back() == '\t')) name.pop_back();
+        if (name != coding && name != "*") return;
+        if (semi != std::string::npos) {
+            std::string params = token.substr(semi + 1);
+            size_t q = params.find("q=");
+            if (q != std::string::npos && std::strtod(params.c_str() + q + 2, nullptr) <= 0.0)
+                return;
+        }
+        accepted = true;
+        });
+    return accepted;
+}
+
+AssetCache::AssetCache(const std::string& dir)
+    : root(dir), table(std::make_shared<const Table>()), watching(false) {}
+
+AssetCache::~AssetCache() {
+    watching = false;
+    if (watcher.joinable()) watcher.join();
+}
+
+bool AssetCache::Load() {
+    std::lock_guard<std::mutex> guard(reloadLock);
+    namespace fs = std::filesystem;
+
+    std::error_code ec;
+    fs::directory_iterator it(root, ec);
+    if (ec) return false;
+
+    auto fresh = std::make_shared<Table>();
+    for (const fs::directory_entry& entry : it) {
+        if (!entry.is_regular_file(ec)) continue;
+
+        std::ifstream file(entry.path(), std::ios::binary);
+        if (!file.is_open()) continue;
+        std::stringstream buf;
+        buf << file.rdbuf();
+
+        auto asset = std::make_shared<Asset>();
+        std::string name = entry.path().filename().string();
+        asset->contentType = ContentTypeFor(name);
+        asset->identity = buf.str();
+        asset->etag = MakeETag(asset->identity, "");
+
+        // Keep a compressed copy only when it actually saves bytes
+        if (asset->identity.size() >= MIN_COMPRESS_SIZE) {
+            asset->gzip = Gzip(asset->identity);
+            if (asset->gzip.size() >= asset->identity.size()) asset->gzip.clear();
+            asset->brotli = Brotli(asset->identity);
+            if (asset->brotli.size() >= asset->identity.size()) asset->brotli.clear();
+        }
+        if (!asset->gzip.empty()) asset->gzipEtag = MakeETag(asset->identity, "-gz");
+        if (!asset->brotli.empty()) asset->brotliEtag = MakeETag(asset->identity, "-br");
+
+        (*fresh)[name] = asset;
+    }
+
+    std::atomic_store(&table, std::shared_ptr<const Table>(fresh));
+    return true;
+}
+
+std::shared_ptr<const Asset> AssetCache::Find(const std::string& name) const {
+    std::shared_ptr<const Table> current = std::atomic_load(&table);
+    auto it = current->find(name);
+    if (it == current->end()) return nullptr;
+    return it->second;
+}
+
+size_t AssetCache::GetAssetCount() const {
+    return std::atomic_load(&table)->size();
+}
+
+AssetBody AssetCache::Select(const Asset& asset, const std::string& acceptEncoding) {
+    if (!asset.brotli.empty() && Accepts(acceptEncoding, "br"))
+        return { &asset.brotli, &asset.brotliEtag, "br" };
+    if (!asset.gzip.empty() && Accepts(acceptEncoding, "gzip"))
+        return { &asset.gzip, &asset.gzipEtag, "gzip" };
+    return { &asset.identity, &asset.etag, nullptr };
+}
+
+bool AssetCache::Matches(const std::string& ifNoneMatch, const std::string& etag) {
+    bool match = false;
+    ForEachToken(ifNoneMatch, [&](const std::string& token) {
+        // If-None-Match uses weak comparison, so a W/ prefix is ignored
+        std::string tag = token.compare(0, 2, "W/") == 0 ? token.substr(2) : token;
+        if (tag == "*" || tag == etag) match = true;
+        });
+    return match;
+}
+
+bool AssetCache::StartWatching() {
+#ifdef __linux__
+    if (watching) return true;
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) return false;
+    uint32_t mask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM;
+    if (inotify_add_watch(fd, root.c_str(), mask) < 0) {
+        close(fd);
+        return false;
+    }
+    watching = true;
+    watcher = std::thread(&AssetCache::WatchLoop, this, fd);
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Waits for directory changes and rebuilds the table. Editors often write a
+// file in several steps, so events are allowed to settle before reloading.
+void AssetCache::WatchLoop(int fd) {
+#ifdef __linux__
+    char events[4096];
+    pollfd pfd = { fd, POLLIN, 0 };
+    while (watching) {
+        if (poll(&pfd, 1, 250) <= 0) continue;
+
+        bool changed = false;
+        do {
+            while (read(fd, events, sizeof(events)) > 0) changed = true;
+        } while (poll(&pfd, 1, 50) > 0);
+
+        if (changed && Load())
+            LOG_INFO("Reloaded {} assets from {}", GetAssetCount(), root);
+    }
+    close(fd);
+#else
+    (void)fd;
+#endif
+}
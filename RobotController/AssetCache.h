@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// One static file, fully prepared for sending. gzip/brotli are empty when
+// the library was not built in or compressing did not make the file smaller.
+// Each representation has its own strong ETag, as HTTP requires.
+struct Asset {
+    std::string contentType;
+    std::string identity;
+    std::string gzip;
+    std::string brotli;
+    std::string etag;        // quoted, e.g. "1f0c...": identity body
+    std::string gzipEtag;
+    std::string brotliEtag;
+};
+
+// Which stored representation of an asset to send
+struct AssetBody {
+    const std::string* body;
+    const std::string* etag;
+    const char* encoding;    // nullptr for identity
+};
+
+// Holds every file in the static directory in memory, read and
+// compressed once at startup. The table is immutable once built: a reload
+// builds a new one and swaps it in, so request threads never lock or touch
+// the disk.
+class AssetCache {
+public:
+    typedef std::unordered_map<std::string, std::shared_ptr<const Asset>> Table;
+
+private:
+    std::string root;
+    std::shared_ptr<const Table> table;
+    std::mutex reloadLock;
+    std::atomic<bool> watching;
+    std::thread watcher;
+
+    void WatchLoop(int fd);
+
+public:
+    explicit AssetCache(const std::string& dir);
+    ~AssetCache();
+
+    // Reads the whole directory into a new table; false if it could not be read
+    bool Load();
+
+    // Dev mode: reloads the table whenever a file in the directory changes.
+    // Linux only (inotify); returns false elsewhere or on failure.
+    bool StartWatching();
+
+    // nullptr if no such file was loaded
+    std::shared_ptr<const Asset> Find(const std::string& name) const;
+
+    size_t GetAssetCount() const;
+
+    // Picks the smallest representation the client's Accept-Encoding allows
+    static AssetBody Select(const Asset& asset, const std::string& acceptEncoding);
+
+    // True if an If-None-Match header lists etag (or is "*")
+    static bool Matches(const std::string& ifNoneMatch, const std::string& etag);
+};
@@ -0,0 +1,110 @@
+#include "CommandScheduler.h"
+#include <algorithm>
+
+CommandScheduler::CommandScheduler(int driveWindow, size_t maxQueued, std::chrono::milliseconds queueWait)
+    : inFlight(0), window(driveWindow), maxDepth(maxQueued), maxWait(queueWait), nextTicket(1), sleeps(0) {}
+
+// Hands free turns to the front of the queue; call with the lock held
+void CommandScheduler::GrantTurns(Outcomes& outcomes) {
+    while (!queued.empty() && inFlight < window) {
+        Ticket& next = queued.front();
+        outcomes.push_back(Outcome{ std::move(next.ready), Admission::SENT, next.waitTimer });
+        queued.pop_front();
+        inFlight++;
+    }
+}
+
+// Runs AdmitAsync callbacks once the lock is released, after cancelling
+// the Withdraw timers they no longer need
+void CommandScheduler::Notify(Outcomes& outcomes) {
+    for (Outcome& outcome : outcomes) {
+        if (outcome.waitTimer != 0 && cancelTimer) cancelTimer(outcome.waitTimer);
+        outcome.ready(outcome.admission);
+    }
+}
+
+void CommandScheduler::Finish(Lane lane) {
+    if (lane == Lane::SAFETY) return;
+    Outcomes outcomes;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        inFlight--;
+        GrantTurns(outcomes);
+    }
+    Notify(outcomes);
+}
+
+CommandScheduler::TicketId CommandScheduler::AdmitAsync(Lane lane, AdmitHandler ready, uint64_t issuedAt) {
+    std::unique_lock<std::mutex> guard(lock);
+    if (lane == Lane::SAFETY) {
+        sleeps++;
+        Outcomes outcomes;
+        for (auto& waiting : queued)
+            outcomes.push_back(Outcome{ std::move(waiting.ready), Admission::PREEMPTED, waiting.waitTimer });
+        queued.clear();
+        guard.unlock();
+        Notify(outcomes);
+        ready(Admission::SENT);
+        return 0;
+    }
+
+    Admission now;
+    if (issuedAt != ANY_TIME && issuedAt < sleeps) {
+        now = Admission::PREEMPTED;
+    }
+    else if (queued.empty() && inFlight < window) {
+        inFlight++;
+        now = Admission::SENT;
+    }
+    else if (queued.size() >= maxDepth) {
+        now = Admission::QUEUE_FULL;
+    }
+    else {
+        TicketId id = nextTicket++;
+        queued.push_back(Ticket{ id, std::move(ready), 0 });
+        return id;
+    }
+    guard.unlock();
+    ready(now);
+    return 0;
+}
+
+void CommandScheduler::Withdraw(TicketId ticket) {
+    Outcomes outcomes;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = std::find_if(queued.begin(), queued.end(),
+            [ticket](const Ticket& t) { return t.id == ticket; });
+        if (it == queued.end()) return;
+        outcomes.push_back(Outcome{ std::move(it->ready), Admission::QUEUE_TIMEOUT, it->waitTimer });
+        queued.erase(it);
+    }
+    Notify(outcomes);
+}
+
+bool CommandScheduler::SetWaitTimer(TicketId ticket, uint64_t timer) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = std::find_if(queued.begin(), queued.end(),
+        [ticket](const Ticket& t) { return t.id == ticket; });
+    if (it == queued.end()) return false;
+    it->waitTimer = timer;
+    return true;
+}
+
+void CommandScheduler::SetTimerCanceller(std::function<void(uint64_t)> cancel) {
+    cancelTimer = std::move(cancel);
+}
+
+std::chrono::milliseconds CommandScheduler::GetMaxWait() const {
+    return maxWait;
+}
+
+uint64_t CommandScheduler::GetSleeps() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return sleeps;
+}
+
+size_t CommandScheduler::GetQueued() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return queued.size();
+}
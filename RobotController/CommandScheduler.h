@@ -0,0 +1,107 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// DRIVE commands (or batched runs of them) a robot may be working on at once
+const int DRIVE_WINDOW = 1;
+// DRIVE commands allowed to wait behind those
+const size_t MAX_QUEUED_DRIVES = 16;
+// Longest a DRIVE may wait for its turn
+const std::chrono::milliseconds MAX_QUEUE_WAIT(2000);
+
+enum class Lane {
+    SAFETY,     // SLEEP: never waits, cancels queued DRIVEs
+    DRIVE
+};
+
+enum class Admission {
+    SENT,           // the caller may send; call Finish when its reply is in
+    QUEUE_FULL,     // too many DRIVEs already waiting
+    PREEMPTED,      // a SLEEP arrived while this DRIVE was queued
+    QUEUE_TIMEOUT   // waited MAX_QUEUE_WAIT without getting a turn
+};
+
+// Gets the outcome of an AdmitAsync
+typedef std::function<void(Admission)> AdmitHandler;
+
+// Orders one robot's outbound commands. DRIVEs go out in arrival order with
+// at most DRIVE_WINDOW awaiting a reply; the rest wait in a bounded queue
+// as callbacks. A SLEEP goes out at once and cancels every queued DRIVE, so
+// the robot never moves again after a stop it was sent.
+class CommandScheduler {
+public:
+    typedef uint64_t TicketId;
+
+    // Passed as issuedAt for a DRIVE that is only ordered against the queue
+    static constexpr uint64_t ANY_TIME = ~uint64_t(0);
+
+private:
+    struct Ticket {
+        TicketId id;
+        AdmitHandler ready;
+        // The caller's Withdraw timer (SetWaitTimer); 0 until it is set
+        uint64_t waitTimer;
+    };
+    struct Outcome {
+        AdmitHandler ready;
+        Admission admission;
+        uint64_t waitTimer;
+    };
+    typedef std::vector<Outcome> Outcomes;
+
+    mutable std::mutex lock;
+    std::deque<Ticket> queued;
+    int inFlight;
+    int window;
+    size_t maxDepth;
+    std::chrono::milliseconds maxWait;
+    TicketId nextTicket;
+    // SLEEPs sent so far
+    uint64_t sleeps;
+
+    std::function<void(uint64_t)> cancelTimer;
+
+    void GrantTurns(Outcomes& outcomes);
+    void Notify(Outcomes& outcomes);
+
+public:
+    CommandScheduler(int driveWindow = DRIVE_WINDOW, size_t maxQueued = MAX_QUEUED_DRIVES,
+        std::chrono::milliseconds queueWait = MAX_QUEUE_WAIT);
+
+    // Asks for a turn in lane: ready gets the outcome, either before this
+    // returns or later on the thread that frees a turn or sends a SLEEP.
+    // SAFETY is always SENT at once. Returns the queued ticket, or 0 if ready
+    // has already run. The caller enforces the queue wait by calling
+    // Withdraw after GetMaxWait.
+    //
+    // issuedAt is GetSleeps() from when the caller was asked for this DRIVE.
+    // If a SLEEP has gone out since, the DRIVE is PREEMPTED just as if it
+    // had been waiting in the queue when the SLEEP arrived.
+    TicketId AdmitAsync(Lane lane, AdmitHandler ready, uint64_t issuedAt = ANY_TIME);
+
+    // Gives back the turn of a command that was SENT, once its reply is in
+    void Finish(Lane lane);
+
+    // Takes a ticket still in the queue out with QUEUE_TIMEOUT; does nothing
+    // once it has an outcome
+    void Withdraw(TicketId ticket);
+
+    // Records the timer that will Withdraw ticket, so it can be cancelled
+    // with cancel (see SetTimerCanceller) as soon as the ticket gets its
+    // outcome some other way. False if it already has, in which case the
+    // caller cancels the timer itself.
+    bool SetWaitTimer(TicketId ticket, uint64_t timer);
+    // Called without the lock held; set once, before the first AdmitAsync
+    void SetTimerCanceller(std::function<void(uint64_t)> cancel);
+
+    std::chrono::milliseconds GetMaxWait() const;
+    uint64_t GetSleeps() const;
+
+    size_t GetQueued() const;
+};
@@ -0,0 +1,42 @@
+#include "Executor.h"
+
+Executor::Executor(int threads) : stopping(false) {
+    for (int i = 0; i < threads; ++i)
+        workers.emplace_back([this]() { Work(); });
+}
+
+Executor::~Executor() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    ready.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+void Executor::Post(std::coroutine_handle<> coroutine) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        queued.push_back(coroutine);
+    }
+    ready.notify_one();
+}
+
+Executor::ScheduleAwaiter Executor::Schedule() {
+    return ScheduleAwaiter{ *this };
+}
+
+void Executor::Work() {
+    for (;;) {
+        std::coroutine_handle<> next;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            ready.wait(guard, [this]() { return stopping || !queued.empty(); });
+            if (queued.empty()) return;
+            next = queued.front();
+            queued.pop_front();
+        }
+        next.resume();
+    }
+}
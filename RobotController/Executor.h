@@ -0,0 +1,41 @@
+#pragma once
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads that resume robot coroutines. They only run the code between two
+// awaits (building packets, formatting results), so a couple are plenty.
+const int EXECUTOR_THREADS = 2;
+
+// A small pool that resumes coroutines. Completions arrive on the Reactor
+// thread, which must not run request code, so they post the waiting
+// coroutine here instead of resuming it in place.
+class Executor {
+private:
+    std::mutex lock;
+    std::condition_variable ready;
+    std::deque<std::coroutine_handle<>> queued;
+    std::vector<std::thread> workers;
+    bool stopping;
+
+    void Work();
+
+public:
+    explicit Executor(int threads = EXECUTOR_THREADS);
+    // Finishes whatever is queued, then joins the workers
+    ~Executor();
+
+    void Post(std::coroutine_handle<> coroutine);
+
+    // co_await executor.Schedule() continues on one of the executor's threads
+    struct ScheduleAwaiter {
+        Executor& executor;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> coroutine) { executor.Post(coroutine); }
+        void await_resume() const noexcept {}
+    };
+    ScheduleAwaiter Schedule();
+};
@@ -0,0 +1,283 @@
+#include "Logger.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Records per thread; a power of two so positions wrap with a mask
+const uint32_t RING_SIZE = 512;
+
+// How long the flusher sleeps when every ring is empty
+const std::chrono::milliseconds FLUSH_INTERVAL(5);
+
+static const char* LEVEL_NAMES[] = { "DEBUG", "INFO ", "WARN ", "ERROR" };
+
+// One producer (the owning thread) and one consumer (whoever holds
+// flushLock). Positions only grow; head - tail is the fill level.
+// A ring whose thread has exited is idle and goes to the next new thread.
+struct LogRing {
+    LogRecord slots[RING_SIZE];
+    alignas(64) std::atomic<uint32_t> head{ 0 };
+    alignas(64) std::atomic<uint32_t> tail{ 0 };
+    std::atomic<bool> inUse{ true };
+    uint16_t threadId;
+};
+
+std::atomic<int> Logger::threshold(0);
+
+static std::atomic<uint64_t> dropped(0);
+
+// Rings outlive their threads so nothing queued is lost, and are reused
+// rather than freed, so there are only ever as many as the most threads
+// that logged at once. The logger is never torn down so static
+// destructors can still log.
+static std::mutex ringsLock;
+static uint16_t threadsSeen = 0;
+static std::vector<LogRing*>& AllRings() {
+    static std::vector<LogRing*>* rings = new std::vector<LogRing*>();
+    return *rings;
+}
+static std::mutex flushLock;
+static std::once_flag flusherStarted;
+
+static thread_local LogRing* localRing = nullptr;
+static thread_local bool threadExited = false;
+
+// Hands the thread's ring back when the thread exits
+struct RingLease {
+    LogRing* ring = nullptr;
+
+    ~RingLease() {
+        if (ring) ring->inUse.store(false, std::memory_order_release);
+        localRing = nullptr;
+        threadExited = true;
+    }
+};
+static thread_local RingLease lease;
+
+static void FlushLoop() {
+    while (true) {
+        std::this_thread::sleep_for(FLUSH_INTERVAL);
+        Logger::Flush();
+    }
+}
+
+// Null once the thread's ring has been handed back, for lines logged by
+// thread_local destructors that run after it
+static LogRing* LocalRing() {
+    if (!localRing) {
+        if (threadExited) return nullptr;
+        LogRing* ring = nullptr;
+        {
+            std::lock_guard<std::mutex> guard(ringsLock);
+            for (LogRing* idle : AllRings()) {
+                bool inUse = false;
+                if (idle->inUse.compare_exchange_strong(inUse, true, std::memory_order_acquire)) {
+                    ring = idle;
+                    break;
+                }
+            }
+            if (!ring) {
+                ring = new LogRing();
+                AllRings().push_back(ring);
+            }
+            ring->threadId = ++threadsSeen;
+        }
+        localRing = ring;
+        lease.ring = ring;
+        std::call_once(flusherStarted, []() {
+            std::thread(FlushLoop).detach();
+            std::atexit([]() { Logger::Flush(); });
+        });
+    }
+    return localRing;
+}
+
+bool LogSite::Admit(uint32_t& droppedLines) {
+    droppedLines = 0;
+    if (perSecond <= 0) return true;
+
+    int64_t second = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t current = window.load(std::memory_order_relaxed);
+    if (current != second && window.compare_exchange_strong(current, second, std::memory_order_relaxed))
+        used.store(0, std::memory_order_relaxed);
+
+    if (used.fetch_add(1, std::memory_order_relaxed) < static_cast<uint32_t>(perSecond)) {
+        if (suppressed.load(std::memory_order_relaxed))
+            droppedLines = suppressed.exchange(0, std::memory_order_relaxed);
+        return true;
+    }
+    suppressed.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+LogRecord* Logger::Claim() {
+    LogRing* ring = LocalRing();
+    if (!ring) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    uint32_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) >= RING_SIZE) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    LogRecord* record = &ring->slots[head & (RING_SIZE - 1)];
+    record->threadId = ring->threadId;
+    return record;
+}
+
+void Logger::Commit() {
+    localRing->head.store(localRing->head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+int64_t Logger::Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void Logger::SetLevel(LogLevel level) {
+    threshold.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+LogLevel Logger::GetLevel() {
+    return static_cast<LogLevel>(threshold.load(std::memory_order_relaxed));
+}
+
+bool Logger::ParseLevel(const std::string& name, LogLevel& level) {
+    if (name == "debug") level = LogLevel::DEBUG;
+    else if (name == "info") level = LogLevel::INFO;
+    else if (name == "warn") level = LogLevel::WARN;
+    else if (name == "error") level = LogLevel::ERR;
+    else if (name == "off") level = LogLevel::OFF;
+    else return false;
+    return true;
+}
+
+uint64_t Logger::GetDropped() {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+uint32_t Logger::GetPending() {
+    std::lock_guard<std::mutex> guard(ringsLock);
+    uint32_t pending = 0;
+    for (LogRing* ring : AllRings())
+        pending += ring->head.load(std::memory_order_acquire) - ring->tail.load(std::memory_order_acquire);
+    return pending;
+}
+
+int Logger::GetRingCount() {
+    std::lock_guard<std::mutex> guard(ringsLock);
+    return static_cast<int>(AllRings().size());
+}
+
+// Appends one argument as text and returns the offset past it
+static int FormatArg(const LogRecord& record, int offset, std::string& out) {
+    char text[32];
+    const char* p = record.payload + offset;
+    switch (static_cast<LogRecord::Tag>(*p)) {
+    case LogRecord::I64: {
+        int64_t v;
+        memcpy(&v, p + 1, sizeof(v));
+        snprintf(text, sizeof(text), "%lld", static_cast<long long>(v));
+        out += text;
+        return offset + 1 + sizeof(v);
+    }
+    case LogRecord::U64: {
+        uint64_t v;
+        memcpy(&v, p + 1, sizeof(v));
+        snprintf(text, sizeof(text), "%llu", static_cast<unsigned long long>(v));
+        out += text;
+        return offset + 1 + sizeof(v);
+    }
+    case LogRecord::F64: {
+        double v;
+        memcpy(&v, p + 1, sizeof(v));
+        snprintf(text, sizeof(text), "%g", v);
+        out += text;
+        return offset + 1 + sizeof(v);
+    }
+    default: {
+        uint8_t n = static_cast<uint8_t>(p[1]);
+        out.append(p + 2, n);
+        return offset + 2 + n;
+    }
+    }
+}
+
+// "2025-04-17T12:00:00.123Z INFO  [t3] message  (main.cpp:42)"
+static void FormatRecord(const LogRecord& record, std::string& out) {
+    time_t seconds = static_cast<time_t>(record.timestampNs / 1000000000);
+    int millis = static_cast<int>((record.timestampNs / 1000000) % 1000);
+    std::tm utc;
+#ifdef _WIN32
+    gmtime_s(&utc, &seconds);
+#else
+    gmtime_r(&seconds, &utc);
+#endif
+    char prefix[64];
+    size_t n = strftime(prefix, sizeof(prefix), "%Y-%m-%dT%H:%M:%S", &utc);
+    snprintf(prefix + n, sizeof(prefix) - n, ".%03dZ %s [t%u] ", millis,
+        LEVEL_NAMES[static_cast<int>(record.site->level)], record.threadId);
+    out += prefix;
+
+    int offset = 0;
+    for (const char* f = record.format; *f; ++f) {
+        if (f[0] == '{' && f[1] == '}') {
+            if (offset < record.size) offset = FormatArg(record, offset, out);
+            ++f;
+        }
+        else {
+            out += *f;
+        }
+    }
+
+    const char* file = record.site->file;
+    for (const char* c = file; *c; ++c)
+        if (*c == '/' || *c == '\\') file = c + 1;
+    snprintf(prefix, sizeof(prefix), "  (%s:%d)", file, record.site->line);
+    out += prefix;
+    if (record.suppressed) {
+        snprintf(prefix, sizeof(prefix), " [%u similar lines suppressed]", record.suppressed);
+        out += prefix;
+    }
+    out += '\n';
+}
+
+void Logger::Flush() {
+    std::lock_guard<std::mutex> flushing(flushLock);
+    std::vector<LogRing*> rings;
+    {
+        std::lock_guard<std::mutex> guard(ringsLock);
+        rings = AllRings();
+    }
+
+    // Merge the rings by timestamp so lines from different threads
+    // come out in the order they were logged
+    std::vector<uint32_t> tails(rings.size()), heads(rings.size());
+    for (size_t i = 0; i < rings.size(); ++i) {
+        tails[i] = rings[i]->tail.load(std::memory_order_relaxed);
+        heads[i] = rings[i]->head.load(std::memory_order_acquire);
+    }
+    std::string out;
+    while (true) {
+        size_t next = rings.size();
+        for (size_t i = 0; i < rings.size(); ++i) {
+            if (tails[i] == heads[i]) continue;
+            if (next == rings.size() || rings[i]->slots[tails[i] & (RING_SIZE - 1)].timestampNs <
+                rings[next]->slots[tails[next] & (RING_SIZE - 1)].timestampNs)
+                next = i;
+        }
+        if (next == rings.size()) break;
+        FormatRecord(rings[next]->slots[tails[next] & (RING_SIZE - 1)], out);
+        rings[next]->tail.store(++tails[next], std::memory_order_release);
+    }
+    if (out.empty()) return;
+    fwrite(out.data(), 1, out.size(), stdout);
+    fflush(stdout);
+}
@@ -0,0 +1,162 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+// ERR rather than ERROR: wingdi.h defines ERROR as a macro
+enum class LogLevel { DEBUG, INFO, WARN, ERR, OFF };
+
+// Call sites below this level are compiled out, arguments and all
+// (0 = DEBUG .. 3 = ERR); the runtime level can only raise it further
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
+// Lines per second each call site may emit before it is throttled
+#ifndef LOG_DEFAULT_RATE
+#define LOG_DEFAULT_RATE 100
+#endif
+
+// One LOG_* statement in the source. Lives in static storage, so records
+// point at it instead of copying the file name.
+struct LogSite {
+    LogLevel level;
+    const char* file;
+    int line;
+    int perSecond;      // 0 = unlimited
+
+    std::atomic<int64_t> window{ 0 };
+    std::atomic<uint32_t> used{ 0 };
+    std::atomic<uint32_t> suppressed{ 0 };
+
+    // False if this second's budget is spent. On success, dropped is how
+    // many earlier lines were throttled, so the gap can be reported.
+    bool Admit(uint32_t& dropped);
+};
+
+// A log line as captured on the calling thread: the format pointer and the
+// raw argument values. Text is only produced later, on the flusher thread.
+struct LogRecord {
+    static const int PAYLOAD = 224;
+
+    int64_t timestampNs;
+    const LogSite* site;
+    const char* format;
+    uint32_t suppressed;
+    uint16_t threadId;
+    uint16_t size;
+    char payload[PAYLOAD];
+
+    enum Tag : char { I64, U64, F64, STR };
+
+    void Put(Tag tag, const void* value, int length) {
+        if (size + 1 + length > PAYLOAD) return;
+        payload[size++] = tag;
+        memcpy(payload + size, value, length);
+        size += length;
+    }
+
+    // Strings are copied, truncated to what is left of the payload
+    void PutString(const char* s, size_t length) {
+        int room = PAYLOAD - size - 2;
+        if (room < 0) return;
+        uint8_t n = static_cast<uint8_t>(length < static_cast<size_t>(room) ? (length < 255 ? length : 255) : room);
+        payload[size++] = STR;
+        payload[size++] = static_cast<char>(n);
+        memcpy(payload + size, s, n);
+        size += n;
+    }
+
+    template <typename T>
+    void Encode(const T& value) {
+        if constexpr (std::is_same<T, std::string>::value) {
+            PutString(value.data(), value.size());
+        }
+        else if constexpr (std::is_convertible<T, const char*>::value) {
+            const char* s = value;
+            if (s) PutString(s, strlen(s));
+            else PutString("(null)", 6);
+        }
+        else if constexpr (std::is_floating_point<T>::value) {
+            double v = value;
+            Put(F64, &v, sizeof(v));
+        }
+        else if constexpr (std::is_enum<T>::value) {
+            int64_t v = static_cast<int64_t>(value);
+            Put(I64, &v, sizeof(v));
+        }
+        else if constexpr (std::is_signed<T>::value) {
+            int64_t v = value;
+            Put(I64, &v, sizeof(v));
+        }
+        else {
+            static_assert(std::is_unsigned<T>::value, "LOG_* arguments must be numbers, enums or strings");
+            uint64_t v = value;
+            Put(U64, &v, sizeof(v));
+        }
+    }
+};
+
+// Asynchronous logger. Each thread writes records into its own
+// single-producer ring without locks or system calls; a background thread
+// drains the rings, formats ("{}" takes the next argument) and writes to
+// stdout in batches. When a ring is full the line is dropped and counted
+// rather than making the caller wait. When a thread exits, its ring goes
+// to the next thread that logs.
+class Logger {
+private:
+    static LogRecord* Claim();
+    static void Commit();
+    static int64_t Now();
+    static std::atomic<int> threshold;
+
+public:
+    // Records below level are skipped at runtime
+    static void SetLevel(LogLevel level);
+    static LogLevel GetLevel();
+    // "debug", "info", "warn" or "error"; false if not recognised
+    static bool ParseLevel(const std::string& name, LogLevel& level);
+
+    template <typename... Args>
+    static void Write(LogSite& site, const char* format, const Args&... args) {
+        if (static_cast<int>(site.level) < threshold.load(std::memory_order_relaxed)) return;
+        uint32_t dropped;
+        if (!site.Admit(dropped)) return;
+        LogRecord* record = Claim();
+        if (!record) return;
+        record->timestampNs = Now();
+        record->site = &site;
+        record->format = format;
+        record->suppressed = dropped;
+        record->size = 0;
+        (record->Encode(args), ...);
+        Commit();
+    }
+
+    // Writes out everything queued so far; called at exit as well
+    static void Flush();
+
+    // Lines lost to full rings
+    static uint64_t GetDropped();
+
+    // Lines queued but not yet written
+    static uint32_t GetPending();
+
+    // Rings allocated so far; a thread that exits hands its ring on
+    static int GetRingCount();
+};
+
+// format must be a string literal: only the pointer is queued
+#define LOG_AT(lvl, rate, ...) do { \
+    if constexpr (static_cast<int>(lvl) >= LOG_MIN_LEVEL) { \
+        static LogSite logSite_{ lvl, __FILE__, __LINE__, rate }; \
+        Logger::Write(logSite_, __VA_ARGS__); \
+    } \
+} while (0)
+
+#define LOG_DEBUG(...) LOG_AT(LogLevel::DEBUG, LOG_DEFAULT_RATE, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LogLevel::INFO, LOG_DEFAULT_RATE, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LogLevel::WARN, LOG_DEFAULT_RATE, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LogLevel::ERR, LOG_DEFAULT_RATE, __VA_ARGS__)
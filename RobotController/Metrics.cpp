@@ -0,0 +1,192 @@
+#include "Metrics.h"
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+const int HISTOGRAMS = static_cast<int>(Histogram::COUNT);
+const int COUNTERS = static_cast<int>(Counter::COUNT);
+
+// 8 sub-buckets per power of two; 320 buckets reach 2^40 ns
+const int SUB_BITS = 3;
+const int SUB_BUCKETS = 1 << SUB_BITS;
+const int BUCKETS = 320;
+
+// Prometheus bucket bounds in nanoseconds (1 us .. 5 s)
+const int64_t EXPORT_BOUNDS[] = {
+    1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+    1000000, 2500000, 5000000, 10000000, 25000000, 50000000,
+    100000000, 250000000, 500000000, 1000000000, 2500000000LL, 5000000000LL
+};
+
+static const char* HISTOGRAM_NAMES[HISTOGRAMS] = {
+    "robotcontroller_http_handler_seconds",
+    "robotcontroller_http_async_response_seconds",
+    "robotcontroller_packet_build_seconds",
+    "robotcontroller_send_syscall_seconds",
+    "robotcontroller_robot_rtt_seconds",
+};
+static const char* HISTOGRAM_HELP[HISTOGRAMS] = {
+    "Time spent in HTTP handlers",
+    "Time from request to response for routes that answer once the robot does",
+    "Time to build and CRC a command packet",
+    "Time spent in one SendData call",
+    "Round trip from sending a packet to its reply",
+};
+static const char* COUNTER_NAMES[COUNTERS] = {
+    "robotcontroller_crc_failures_total",
+    "robotcontroller_reply_timeouts_total",
+    "robotcontroller_retransmits_total",
+};
+static const char* COUNTER_HELP[COUNTERS] = {
+    "Robot packets received with a bad CRC",
+    "Requests that got no reply before their deadline",
+    "Reliable-mode packets sent again after their RTO passed",
+};
+
+// One thread's metrics. Only the owning thread writes, so an add is a
+// relaxed load and store; readers may see a value one event old.
+struct Shard {
+    std::atomic<uint64_t> buckets[HISTOGRAMS][BUCKETS];
+    std::atomic<uint64_t> sums[HISTOGRAMS];
+    std::atomic<uint64_t> counters[COUNTERS];
+
+    Shard() {
+        for (auto& h : buckets)
+            for (auto& b : h) b.store(0, std::memory_order_relaxed);
+        for (auto& s : sums) s.store(0, std::memory_order_relaxed);
+        for (auto& c : counters) c.store(0, std::memory_order_relaxed);
+    }
+};
+
+static inline void Add(std::atomic<uint64_t>& cell, uint64_t n) {
+    cell.store(cell.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// Shards are kept after their thread exits so its counts are not lost
+static std::mutex shardsLock;
+static std::vector<std::unique_ptr<Shard>>& AllShards() {
+    static std::vector<std::unique_ptr<Shard>> shards;
+    return shards;
+}
+
+static Shard& LocalShard() {
+    thread_local Shard* local = nullptr;
+    if (!local) {
+        std::lock_guard<std::mutex> guard(shardsLock);
+        AllShards().push_back(std::make_unique<Shard>());
+        local = AllShards().back().get();
+    }
+    return *local;
+}
+
+static inline int HighestBit(uint64_t v) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, v);
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(v);
+#endif
+}
+
+static int BucketIndex(uint64_t v) {
+    if (v < SUB_BUCKETS) return static_cast<int>(v);
+    int msb = HighestBit(v);
+    int shift = msb - SUB_BITS;
+    int index = (shift + 1) * SUB_BUCKETS + static_cast<int>((v >> shift) & (SUB_BUCKETS - 1));
+    return index < BUCKETS ? index : BUCKETS - 1;
+}
+
+// Smallest value that no longer falls in this bucket
+static uint64_t BucketUpperBound(int index) {
+    if (index < SUB_BUCKETS) return index + 1;
+    int shift = index / SUB_BUCKETS - 1;
+    uint64_t sub = index % SUB_BUCKETS;
+    return (SUB_BUCKETS + sub + 1) << shift;
+}
+
+void Metrics::Record(Histogram h, int64_t nanoseconds) {
+    uint64_t v = nanoseconds > 0 ? static_cast<uint64_t>(nanoseconds) : 0;
+    int which = static_cast<int>(h);
+    Shard& shard = LocalShard();
+    Add(shard.buckets[which][BucketIndex(v)], 1);
+    Add(shard.sums[which], v);
+}
+
+void Metrics::Increment(Counter c, uint64_t n) {
+    Add(LocalShard().counters[static_cast<int>(c)], n);
+}
+
+uint64_t Metrics::GetCount(Histogram h) {
+    int which = static_cast<int>(h);
+    uint64_t total = 0;
+    std::lock_guard<std::mutex> guard(shardsLock);
+    for (auto& shard : AllShards())
+        for (auto& b : shard->buckets[which])
+            total += b.load(std::memory_order_relaxed);
+    return total;
+}
+
+uint64_t Metrics::GetCount(Counter c) {
+    uint64_t total = 0;
+    std::lock_guard<std::mutex> guard(shardsLock);
+    for (auto& shard : AllShards())
+        total += shard->counters[static_cast<int>(c)].load(std::memory_order_relaxed);
+    return total;
+}
+
+std::string Metrics::RenderPrometheus() {
+    uint64_t buckets[HISTOGRAMS][BUCKETS] = {};
+    uint64_t sums[HISTOGRAMS] = {};
+    uint64_t counters[COUNTERS] = {};
+    {
+        std::lock_guard<std::mutex> guard(shardsLock);
+        for (auto& shard : AllShards()) {
+            for (int h = 0; h < HISTOGRAMS; ++h) {
+                for (int b = 0; b < BUCKETS; ++b)
+                    buckets[h][b] += shard->buckets[h][b].load(std::memory_order_relaxed);
+                sums[h] += shard->sums[h].load(std::memory_order_relaxed);
+            }
+            for (int c = 0; c < COUNTERS; ++c)
+                counters[c] += shard->counters[c].load(std::memory_order_relaxed);
+        }
+    }
+
+    std::string out;
+    char line[256];
+    for (int h = 0; h < HISTOGRAMS; ++h) {
+        out += std::string("# HELP ") + HISTOGRAM_NAMES[h] + " " + HISTOGRAM_HELP[h] + "\n";
+        out += std::string("# TYPE ") + HISTOGRAM_NAMES[h] + " histogram\n";
+
+        // An internal bucket counts toward the first exported bound that
+        // covers all of it, so exported latencies err on the high side
+        uint64_t cumulative = 0;
+        int b = 0;
+        for (int64_t bound : EXPORT_BOUNDS) {
+            while (b < BUCKETS && BucketUpperBound(b) <= static_cast<uint64_t>(bound))
+                cumulative += buckets[h][b++];
+            snprintf(line, sizeof(line), "%s_bucket{le=\"%g\"} %llu\n",
+                HISTOGRAM_NAMES[h], bound / 1e9, static_cast<unsigned long long>(cumulative));
+            out += line;
+        }
+        uint64_t total = cumulative;
+        for (; b < BUCKETS; ++b) total += buckets[h][b];
+        snprintf(line, sizeof(line), "%s_bucket{le=\"+Inf\"} %llu\n%s_sum %.9f\n%s_count %llu\n",
+            HISTOGRAM_NAMES[h], static_cast<unsigned long long>(total),
+            HISTOGRAM_NAMES[h], sums[h] / 1e9,
+            HISTOGRAM_NAMES[h], static_cast<unsigned long long>(total));
+        out += line;
+    }
+    for (int c = 0; c < COUNTERS; ++c) {
+        out += std::string("# HELP ") + COUNTER_NAMES[c] + " " + COUNTER_HELP[c] + "\n";
+        out += std::string("# TYPE ") + COUNTER_NAMES[c] + " counter\n";
+        snprintf(line, sizeof(line), "%s %llu\n", COUNTER_NAMES[c], static_cast<unsigned long long>(counters[c]));
+        out += line;
+    }
+    return out;
+}
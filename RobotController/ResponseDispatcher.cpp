@@ -0,0 +1,252 @@
+#include "ResponseDispatcher.h"
+#include "Metrics.h"
+#include <algorithm>
+
+// Reactor timers take whole milliseconds; rounding up means the last
+// timer of a request never fires before its deadline
+static std::chrono::milliseconds RoundUp(Reactor::Clock::duration wait) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(wait + std::chrono::microseconds(999));
+}
+
+ResponseDispatcher::ResponseDispatcher(MySocket& sock, Reactor& loop)
+    : socket(sock), reactor(loop), nextGeneration(1), closing(false), reliableInFlight(0),
+    answered(RECENT_REPLIES, -1), answeredNext(0), bytesReceived(0), crcFailures(0), timeouts(0), retransmits(0)
+{
+    reactor.Watch(socket, [this]() { OnReadable(); });
+}
+
+ResponseDispatcher::~ResponseDispatcher() {
+    reactor.Unwatch(socket);
+
+    std::vector<Reactor::TimerId> timers;
+    {
+        // A running retransmit sees closing and does not re-arm its timer
+        std::lock_guard<std::mutex> guard(lock);
+        closing = true;
+        for (auto& entry : pending)
+            timers.push_back(entry.second.timer);
+    }
+    // Cancelling waits for a running expiry, which needs the lock itself
+    for (Reactor::TimerId id : timers)
+        reactor.CancelTimer(id);
+
+    // Anyone still waiting gets a timeout instead of a broken promise
+    std::vector<ReplyHandler> waiting;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (auto& entry : pending)
+            waiting.push_back(std::move(entry.second.complete));
+        pending.clear();
+    }
+    for (ReplyHandler& done : waiting)
+        done(Reply());
+}
+
+// Adapts a handler-based request to the blocking API's future
+static ReplyHandler Fulfil(std::future<Reply>& result) {
+    auto promise = std::make_shared<std::promise<Reply>>();
+    result = promise->get_future();
+    return [promise](Reply reply) { promise->set_value(std::move(reply)); };
+}
+
+std::future<Reply> ResponseDispatcher::Expect(int pktCount, std::chrono::milliseconds timeout) {
+    std::future<Reply> result;
+    Register(pktCount, timeout, nullptr, 0, Fulfil(result));
+    return result;
+}
+
+std::future<Reply> ResponseDispatcher::ExpectReliable(int pktCount, const char* raw, int length,
+    std::chrono::milliseconds timeout) {
+    std::future<Reply> result;
+    Register(pktCount, timeout, raw, length, Fulfil(result));
+    return result;
+}
+
+void ResponseDispatcher::Expect(int pktCount, std::chrono::milliseconds timeout, ReplyHandler done) {
+    Register(pktCount, timeout, nullptr, 0, std::move(done));
+}
+
+void ResponseDispatcher::ExpectReliable(int pktCount, const char* raw, int length,
+    std::chrono::milliseconds timeout, ReplyHandler done) {
+    Register(pktCount, timeout, raw, length, std::move(done));
+}
+
+void ResponseDispatcher::Register(int pktCount, std::chrono::milliseconds timeout,
+    const char* raw, int length, ReplyHandler done) {
+    uint16_t key = static_cast<uint16_t>(pktCount);
+    Pending entry;
+    entry.complete = std::move(done);
+    entry.sent = Reactor::Clock::now();
+    entry.deadline = entry.sent + timeout;
+    entry.attempts = 1;
+
+    ReplyHandler superseded;
+    std::unique_lock<std::mutex> guard(lock);
+    // The count is in use again, so its replies are no longer repeats
+    std::replace(answered.begin(), answered.end(), static_cast<int>(key), -1);
+    auto it = pending.find(key);
+    if (it != pending.end()) {
+        // A stale request with the same count can never be matched correctly.
+        // Its timer still fires, but the generation check makes it a no-op.
+        superseded = std::move(it->second.complete);
+        Forget(it->second);
+        pending.erase(it);
+    }
+
+    // The first timer is the RTO for reliable requests, else the deadline
+    Reactor::Clock::duration wait = timeout;
+    if (raw && reliableInFlight < RELIABLE_WINDOW) {
+        entry.packet = PacketBuffer(raw, length);
+        reliableInFlight++;
+        std::chrono::microseconds rto = rtt.GetRto();
+        if (rto < wait) wait = rto;
+    }
+    uint64_t generation = nextGeneration++;
+    entry.generation = generation;
+    entry.timer = reactor.RunAfter(RoundUp(wait), [this, key, generation]() { Expire(key, generation); });
+    pending.emplace(key, std::move(entry));
+    guard.unlock();
+    if (superseded) superseded(Reply());
+}
+
+// Bookkeeping for an entry leaving the table; call with the lock held
+void ResponseDispatcher::Forget(Pending& entry) {
+    if (!entry.packet.empty()) reliableInFlight--;
+}
+
+// Whether a reply to pktCount was delivered lately; call with the lock held
+bool ResponseDispatcher::WasAnswered(uint16_t pktCount) const {
+    return std::find(answered.begin(), answered.end(), static_cast<int>(pktCount)) != answered.end();
+}
+
+bool ResponseDispatcher::Cancel(int pktCount) {
+    std::unique_lock<std::mutex> guard(lock);
+    auto it = pending.find(static_cast<uint16_t>(pktCount));
+    if (it == pending.end()) return false;
+    Reactor::TimerId timer = it->second.timer;
+    Forget(it->second);
+    pending.erase(it);
+    guard.unlock();
+    reactor.CancelTimer(timer);
+    return true;
+}
+
+void ResponseDispatcher::SetUnsolicitedHandler(std::function<void(const char*, int)> handler) {
+    std::lock_guard<std::mutex> guard(lock);
+    unsolicited = std::move(handler);
+}
+
+// Drains everything the kernel has queued for this socket, decoding packets
+// in place in the socket's own buffer
+void ResponseDispatcher::OnReadable() {
+    bool stream = socket.GetConnectionType() == ConnectionType::TCP;
+    int bytes;
+    while ((bytes = socket.GetData(nullptr)) > 0) {
+        bytesReceived.store(bytesReceived.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+        if (!stream) {
+            PktView pkt(socket.GetBuffer(), bytes);
+            if (pkt.IsValid())
+                Deliver(pkt);
+            continue;
+        }
+
+        PktView pkt;
+        framer.Feed(socket.GetBuffer(), bytes);
+        while (framer.Next(pkt))
+            Deliver(pkt);
+    }
+
+    // The robot closed the connection; stop polling an fd that stays readable
+    if (stream && bytes == 0)
+        reactor.Unwatch(socket);
+}
+
+// Completes the request waiting on this packet's pktCount, if any
+void ResponseDispatcher::Deliver(const PktView& pkt) {
+    // A corrupted reply, whose pktCount may be wrong too, answers nothing:
+    // the request keeps waiting, and a reliable one is resent at its RTO
+    if (!pkt.CheckCRC()) {
+        crcFailures.store(crcFailures.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        Metrics::Increment(Counter::CRC_FAILURES);
+        return;
+    }
+    uint16_t pktCount = static_cast<uint16_t>(pkt.GetPktCount());
+    const char* raw = pkt.GetRaw();
+    int size = pkt.GetLength();
+
+    std::unique_lock<std::mutex> guard(lock);
+    auto it = pending.find(pktCount);
+    if (it != pending.end()) {
+        Pending entry = std::move(it->second);
+        Forget(entry);
+        pending.erase(it);
+        answered[answeredNext] = pktCount;
+        answeredNext = (answeredNext + 1) % answered.size();
+        guard.unlock();
+        // Karn's rule: after a resend we cannot tell which copy was answered
+        if (entry.attempts == 1)
+            rtt.Sample(std::chrono::duration_cast<std::chrono::microseconds>(Reactor::Clock::now() - entry.sent));
+        // We are on the reactor thread, so this never waits
+        reactor.CancelTimer(entry.timer);
+        entry.complete(Reply(raw, size));
+        return;
+    }
+
+    // A second copy of an answered reply, typically to a resent request
+    if (WasAnswered(pktCount)) return;
+
+    // Late ACKs and robot-initiated packets end up here instead of being
+    // read by whichever request happens to call GetData next
+    std::function<void(const char*, int)> handler = unsolicited;
+    guard.unlock();
+    if (handler) handler(raw, size);
+}
+
+// Retransmission timeout or deadline: resend a reliable request that still
+// has time left, otherwise complete it with an empty reply
+void ResponseDispatcher::Expire(uint16_t pktCount, uint64_t generation) {
+    std::unique_lock<std::mutex> guard(lock);
+    auto it = pending.find(pktCount);
+    if (it == pending.end() || it->second.generation != generation) return;
+
+    Pending& waiting = it->second;
+    Reactor::Clock::time_point now = Reactor::Clock::now();
+    if (!waiting.packet.empty() && !closing && now < waiting.deadline) {
+        socket.SendData(waiting.packet.data(), static_cast<int>(waiting.packet.size()));
+        retransmits.store(retransmits.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        Metrics::Increment(Counter::RETRANSMITS);
+
+        Reactor::Clock::duration wait = RttEstimator::Backoff(rtt.GetRto(), waiting.attempts++);
+        if (waiting.deadline - now < wait) wait = waiting.deadline - now;
+        waiting.timer = reactor.RunAfter(RoundUp(wait), [this, pktCount, generation]() { Expire(pktCount, generation); });
+        return;
+    }
+
+    Pending entry = std::move(waiting);
+    Forget(entry);
+    pending.erase(it);
+    guard.unlock();
+    timeouts.store(timeouts.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    Metrics::Increment(Counter::TIMEOUTS);
+    entry.complete(Reply());
+}
+
+uint64_t ResponseDispatcher::GetBytesReceived() const {
+    return bytesReceived.load(std::memory_order_relaxed);
+}
+
+uint64_t ResponseDispatcher::GetCrcFailures() const {
+    return crcFailures.load(std::memory_order_relaxed);
+}
+
+uint64_t ResponseDispatcher::GetTimeouts() const {
+    return timeouts.load(std::memory_order_relaxed);
+}
+
+uint64_t ResponseDispatcher::GetRetransmits() const {
+    return retransmits.load(std::memory_order_relaxed);
+}
+
+std::chrono::microseconds ResponseDispatcher::GetRto() const {
+    return rtt.GetRto();
+}
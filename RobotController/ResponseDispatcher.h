@@ -0,0 +1,112 @@
+#pragma once
+#include "../MySocket/MySocket.h"
+#include "../MySocket/Reactor.h"
+#include "../MySocket/RttEstimator.h"
+#include "../PktDef/PacketPool.h"
+#include "../PktDef/PktDef.h"
+#include "../PktDef/PktFramer.h"
+#include "../PktDef/PktView.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Most reliable requests being retransmitted at once per robot; requests
+// beyond this are sent once, as if unreliable
+const int RELIABLE_WINDOW = 64;
+// Answered pktCounts remembered so a late duplicate reply is dropped rather
+// than passed on as unsolicited
+const int RECENT_REPLIES = 64;
+
+// Raw bytes of a robot reply, in a pooled block; empty when the deadline
+// passed without one
+typedef PacketBuffer Reply;
+
+// Called once with a request's Reply. It runs on the reactor thread (or on
+// whichever thread supersedes the request or closes the dispatcher), so it
+// must hand work off rather than block.
+typedef std::function<void(Reply)> ReplyHandler;
+
+// Owns the receive side of a robot socket and hands each incoming packet to
+// the request that is waiting on its pktCount. Reads and deadlines run on the
+// shared Reactor thread, so no thread is ever parked in GetData. Over TCP the
+// stream is cut into packets by a PktFramer, so coalesced or split reads work.
+//
+// Requests registered with ExpectReliable are also resent until they are
+// answered or their deadline passes, with a timeout that adapts to the
+// measured round trip and doubles after each resend.
+class ResponseDispatcher {
+private:
+    struct Pending {
+        ReplyHandler complete;
+        Reactor::TimerId timer;
+        uint64_t generation;
+        Reactor::Clock::time_point sent;
+        // Reliable requests only: what to resend, and until when
+        PacketBuffer packet;
+        Reactor::Clock::time_point deadline;
+        int attempts;
+    };
+
+    MySocket& socket;
+    Reactor& reactor;
+    PktFramer framer;
+    std::unordered_map<uint16_t, Pending> pending;
+    std::mutex lock;
+    std::function<void(const char*, int)> unsolicited;
+    uint64_t nextGeneration;
+    bool closing;
+    int reliableInFlight;
+    RttEstimator rtt;
+    // Ring of the last RECENT_REPLIES pktCounts answered (-1 = empty slot)
+    std::vector<int> answered;
+    size_t answeredNext;
+
+    // Written only on the reactor thread, read by /metrics
+    std::atomic<uint64_t> bytesReceived;
+    std::atomic<uint64_t> crcFailures;
+    std::atomic<uint64_t> timeouts;
+    std::atomic<uint64_t> retransmits;
+
+    void OnReadable();
+    void Deliver(const PktView& pkt);
+    void Expire(uint16_t pktCount, uint64_t generation);
+    void Register(int pktCount, std::chrono::milliseconds timeout, const char* raw, int length, ReplyHandler done);
+    void Forget(Pending& entry);
+    bool WasAnswered(uint16_t pktCount) const;
+
+public:
+    // Registers the socket with the reactor; both must outlive the dispatcher
+    ResponseDispatcher(MySocket& sock, Reactor& loop);
+    ~ResponseDispatcher();
+
+    // Registers interest in the reply to pktCount. Call before sending so a
+    // fast ACK cannot arrive first. The future yields an empty Reply on timeout.
+    std::future<Reply> Expect(int pktCount, std::chrono::milliseconds timeout);
+
+    // Expect, plus resending packet (the first copy is the caller's to send)
+    // each time the retransmission timeout passes without a reply
+    std::future<Reply> ExpectReliable(int pktCount, const char* raw, int length, std::chrono::milliseconds timeout);
+
+    // The same, completing through done instead of a future
+    void Expect(int pktCount, std::chrono::milliseconds timeout, ReplyHandler done);
+    void ExpectReliable(int pktCount, const char* raw, int length, std::chrono::milliseconds timeout, ReplyHandler done);
+
+    // Drops a pending request without completing it. False if it was no
+    // longer pending, i.e. its handler has run or is about to.
+    bool Cancel(int pktCount);
+
+    // Called for packets that no pending request is waiting on, other than
+    // repeats of a reply already delivered
+    void SetUnsolicitedHandler(std::function<void(const char*, int)> handler);
+
+    uint64_t GetBytesReceived() const;
+    uint64_t GetCrcFailures() const;
+    uint64_t GetTimeouts() const;
+    uint64_t GetRetransmits() const;
+    std::chrono::microseconds GetRto() const;
+};
@@ -0,0 +1,338 @@
+#include "RobotSession.h"
+#include "Metrics.h"
+
+RobotSession::RobotSession(const std::string& robotId, const std::string& robotIP, int robotPort,
+    ConnectionType connection, Reactor& loop, Executor& pool, std::shared_ptr<TelemetryHub> streams,
+    std::shared_ptr<TelemetryHistory> past)
+    : id(robotId), ip(robotIP), port(robotPort), type(connection), reliable(false), reactor(loop), executor(pool),
+    history(past ? std::move(past) : std::make_shared<TelemetryHistory>()),
+    hub(streams ? std::move(streams) : std::make_shared<TelemetryHub>()), bytesSent(0) {
+    scheduler.SetTimerCanceller([this](uint64_t timer) { reactor.CancelTimer(timer); });
+}
+
+bool RobotSession::Open(int pollHz, bool retransmit) {
+    // TCP already retransmits
+    reliable = retransmit && type == ConnectionType::UDP;
+    socket = std::make_unique<MySocket>(SocketType::CLIENT, ip, port, type, 1024, reactor.GetRing());
+    if (type == ConnectionType::TCP) {
+        socket->ConnectTCP();
+        if (!socket->IsTCPConnected()) {
+            socket.reset();
+            return false;
+        }
+    }
+    dispatcher = std::make_unique<ResponseDispatcher>(*socket, reactor);
+
+    // Poll requests are fire-and-forget; their replies arrive unsolicited
+    dispatcher->SetUnsolicitedHandler([this](const char* raw, int size) {
+        PublishTelemetry(PktView(raw, size));
+        });
+    poller = std::make_unique<TelemetryPoller>(reactor, [this]() {
+        int pktCount = sequence.Next();
+        if (pktCount < 0) return;
+        char raw[PKT_TEMPLATE_SIZE];
+        Send(raw, TELEMETRY_REQUEST_TEMPLATE.Stamp(raw, sizeof(raw), static_cast<uint16_t>(pktCount)));
+        }, pollHz);
+    return true;
+}
+
+// Timed and counted so /metrics shows what the socket itself costs
+void RobotSession::Send(const char* raw, int length) {
+    Metrics::Clock::time_point start = Metrics::Clock::now();
+    socket->SendData(raw, length);
+    Metrics::Record(Histogram::SEND_SYSCALL, start);
+    bytesSent.fetch_add(length, std::memory_order_relaxed);
+}
+
+// Registers for a reply, with retransmission when the session is reliable
+std::future<Reply> RobotSession::Expect(int pktCount, const char* raw, int length, std::chrono::milliseconds timeout) {
+    if (reliable)
+        return dispatcher->ExpectReliable(pktCount, raw, length, timeout);
+    return dispatcher->Expect(pktCount, timeout);
+}
+
+void RobotSession::Expect(int pktCount, const char* raw, int length, std::chrono::milliseconds timeout, ReplyHandler done) {
+    if (reliable)
+        dispatcher->ExpectReliable(pktCount, raw, length, timeout, std::move(done));
+    else
+        dispatcher->Expect(pktCount, timeout, std::move(done));
+}
+
+int RobotSession::AcquirePktCount() {
+    return sequence.Acquire();
+}
+
+void RobotSession::BuildTelemetryRequest(PktDef& pkt, int pktCount) {
+    pkt.SetCmd(CmdType::RESPONSE);
+    pkt.SetAck(false);
+    pkt.SetPktCount(pktCount);
+    pkt.SetBodyData(nullptr, 0);
+    pkt.CalcCRC();
+}
+
+Reply RobotSession::Transact(PktDef& pkt, std::chrono::milliseconds timeout) {
+    int pktCount = pkt.GetPktCount();
+    if (!dispatcher) {
+        sequence.Release(pktCount);
+        return Reply();
+    }
+    // Register before sending so a fast reply cannot arrive first
+    const char* raw = pkt.GenPacket();
+    std::future<Reply> pending = Expect(pktCount, raw, pkt.GetLength(), timeout);
+    Metrics::Clock::time_point sent = Metrics::Clock::now();
+    Send(raw, pkt.GetLength());
+    Reply reply = pending.get();
+    if (!reply.empty())
+        Metrics::Record(Histogram::ROBOT_RTT, sent);
+    sequence.Release(pktCount);
+    return reply;
+}
+
+void RobotSession::TransactAsync(const char* raw, int length, int pktCount,
+    std::chrono::milliseconds timeout, ReplyHandler done) {
+    if (!dispatcher) {
+        sequence.Release(pktCount);
+        done(Reply());
+        return;
+    }
+    Metrics::Clock::time_point sent = Metrics::Clock::now();
+    Expect(pktCount, raw, length, timeout,
+        [this, pktCount, sent, done = std::move(done)](Reply reply) {
+            if (!reply.empty())
+                Metrics::Record(Histogram::ROBOT_RTT, sent);
+            sequence.Release(pktCount);
+            done(std::move(reply));
+        });
+    Send(raw, length);
+}
+
+void RobotSession::TransactBatchAsync(const char* arena, const int* lengths, const uint16_t* pktCounts, int count,
+    std::chrono::milliseconds timeout, std::function<void(std::vector<Reply>)> done) {
+    if (!dispatcher) {
+        for (int i = 0; i < count; ++i)
+            sequence.Release(pktCounts[i]);
+        done(std::vector<Reply>(count));
+        return;
+    }
+
+    // Filled in by the reply handlers; whichever settles last hands it over
+    struct Gather {
+        std::vector<Reply> replies;
+        std::atomic<int> left;
+        std::function<void(std::vector<Reply>)> done;
+    };
+    auto gather = std::make_shared<Gather>();
+    gather->replies.resize(count);
+    gather->left = count;
+    gather->done = std::move(done);
+    Metrics::Clock::time_point sent = Metrics::Clock::now();
+    auto settle = [this, gather, sent](int i, int pktCount, Reply reply) {
+        if (!reply.empty())
+            Metrics::Record(Histogram::ROBOT_RTT, sent);
+        sequence.Release(pktCount);
+        gather->replies[i] = std::move(reply);
+        if (gather->left.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            gather->done(std::move(gather->replies));
+    };
+
+    std::vector<Datagram> msgs(count);
+    int total = 0;
+    for (int i = 0; i < count; total += lengths[i++]) {
+        char* raw = const_cast<char*>(arena) + total;
+        msgs[i] = Datagram{ raw, lengths[i], nullptr };
+        int pktCount = pktCounts[i];
+        Expect(pktCount, raw, lengths[i], timeout,
+            [settle, i, pktCount](Reply reply) { settle(i, pktCount, std::move(reply)); });
+    }
+
+    Metrics::Clock::time_point start = Metrics::Clock::now();
+    int delivered;
+    if (type == ConnectionType::TCP) {
+        // The arena is already the byte stream the robot expects
+        Datagram stream{ const_cast<char*>(arena), total, nullptr };
+        delivered = socket->SendBatch(&stream, 1) == 1 ? count : 0;
+    }
+    else {
+        delivered = socket->SendBatch(msgs.data(), count);
+        if (delivered < 0) delivered = 0;
+    }
+    Metrics::Record(Histogram::SEND_SYSCALL, start);
+    for (int i = 0; i < delivered; ++i)
+        bytesSent.fetch_add(lengths[i], std::memory_order_relaxed);
+
+    // Whatever did not go out will never be answered; settle it now
+    for (int i = delivered; i < count; ++i) {
+        if (dispatcher->Cancel(pktCounts[i]))
+            settle(i, pktCounts[i], Reply());
+    }
+}
+
+void RobotSession::AdmitAsync(Lane lane, AdmitHandler ready, uint64_t issuedAt) {
+    CommandScheduler::TicketId ticket = scheduler.AdmitAsync(lane, std::move(ready), issuedAt);
+    if (ticket == 0) return;
+    // The scheduler cancels the timer once the ticket settles otherwise
+    std::weak_ptr<RobotSession> self = weak_from_this();
+    Reactor::TimerId timer = reactor.RunAfter(scheduler.GetMaxWait(), [self, ticket]() {
+        if (std::shared_ptr<RobotSession> session = self.lock())
+            session->scheduler.Withdraw(ticket);
+        });
+    if (!scheduler.SetWaitTimer(ticket, timer))
+        reactor.CancelTimer(timer);
+}
+
+Task<CommandResult> RobotSession::Command(PktDef& pkt, std::chrono::milliseconds timeout) {
+    Lane lane = pkt.GetCmd() == CmdType::SLEEP ? Lane::SAFETY : Lane::DRIVE;
+    const char* raw = pkt.GenPacket();
+    co_return co_await SendFrame(raw, pkt.GetLength(), pkt.GetPktCount(), lane, timeout);
+}
+
+Task<CommandResult> RobotSession::SendFrame(const char* raw, int length, int pktCount, Lane lane,
+    std::chrono::milliseconds timeout, uint64_t issuedAt) {
+    std::shared_ptr<RobotSession> self = shared_from_this();
+    Admission admission = co_await CallbackAwaiter<Admission>(executor, [this, lane, issuedAt](AdmitHandler ready) {
+        AdmitAsync(lane, std::move(ready), issuedAt);
+        });
+    if (admission != Admission::SENT) {
+        sequence.Release(pktCount);
+        co_return CommandResult{ admission, Reply() };
+    }
+    Reply reply = co_await CallbackAwaiter<Reply>(executor, [=, this](ReplyHandler done) {
+        TransactAsync(raw, length, pktCount, timeout, std::move(done));
+        });
+    scheduler.Finish(lane);
+    co_return CommandResult{ admission, std::move(reply) };
+}
+
+// Drive and Sleep stamp a pktCount into a prebuilt frame instead of going
+// through PktDef; SLEEP's frame is built at compile time
+Task<CommandResult> RobotSession::Drive(uint8_t direction, int duration, int speed, std::chrono::milliseconds timeout,
+    uint64_t issuedAt) {
+    int pktCount = sequence.Acquire();
+    if (pktCount < 0) co_return CommandResult{ Admission::QUEUE_FULL, Reply() };
+    char raw[PKT_TEMPLATE_SIZE];
+    int length = PktTemplate::Drive(direction, static_cast<uint8_t>(duration), static_cast<uint8_t>(speed))
+        .Stamp(raw, sizeof(raw), static_cast<uint16_t>(pktCount));
+    co_return co_await SendFrame(raw, length, pktCount, Lane::DRIVE, timeout, issuedAt);
+}
+
+Task<CommandResult> RobotSession::Sleep(std::chrono::milliseconds timeout) {
+    int pktCount = sequence.Acquire();
+    if (pktCount < 0) co_return CommandResult{ Admission::QUEUE_FULL, Reply() };
+    char raw[PKT_TEMPLATE_SIZE];
+    int length = SLEEP_TEMPLATE.Stamp(raw, sizeof(raw), static_cast<uint16_t>(pktCount));
+    co_return co_await SendFrame(raw, length, pktCount, Lane::SAFETY, timeout);
+}
+
+Task<std::vector<CommandResult>> RobotSession::DriveBatch(std::vector<DriveBody> drives,
+    std::chrono::milliseconds timeout, uint64_t issuedAt) {
+    std::shared_ptr<RobotSession> self = shared_from_this();
+    int count = static_cast<int>(drives.size());
+    std::vector<CommandResult> results;
+    results.reserve(count);
+    for (int i = 0; i < count; ++i)
+        results.push_back(CommandResult{ Admission::QUEUE_FULL, Reply() });
+    std::vector<uint16_t> pktCounts(count);
+    int acquired = sequence.AcquireBlock(pktCounts.data(), count);
+    if (acquired == 0) co_return results;
+
+    // One arena for the whole run, in the order it goes out
+    std::vector<char> arena(static_cast<size_t>(acquired) * PKT_TEMPLATE_SIZE);
+    std::vector<int> lengths(acquired);
+    for (int i = 0, offset = 0; i < acquired; offset += lengths[i++]) {
+        const DriveBody& drive = drives[i];
+        lengths[i] = PktTemplate::Drive(drive.direction, drive.duration, drive.speed)
+            .Stamp(arena.data() + offset, PKT_TEMPLATE_SIZE, pktCounts[i]);
+    }
+
+    Admission admission = co_await CallbackAwaiter<Admission>(executor, [this, issuedAt](AdmitHandler ready) {
+        AdmitAsync(Lane::DRIVE, std::move(ready), issuedAt);
+        });
+    if (admission != Admission::SENT) {
+        for (int i = 0; i < acquired; ++i) {
+            sequence.Release(pktCounts[i]);
+            results[i].admission = admission;
+        }
+        co_return results;
+    }
+    std::vector<Reply> replies = co_await CallbackAwaiter<std::vector<Reply>>(executor,
+        [&](std::function<void(std::vector<Reply>)> done) {
+            TransactBatchAsync(arena.data(), lengths.data(), pktCounts.data(), acquired, timeout, std::move(done));
+        });
+    scheduler.Finish(Lane::DRIVE);
+    for (int i = 0; i < acquired; ++i)
+        results[i] = CommandResult{ Admission::SENT, std::move(replies[i]) };
+    co_return results;
+}
+
+void RobotSession::PublishTelemetry(const PktView& pkt) {
+    if (pkt.GetCmd() == CmdType::RESPONSE && pkt.GetBodyLength() >= 7 && pkt.CheckCRC()) {
+        Telemetry t = pkt.ParseTelemetry();
+        cache.Store(t);
+        history->Append(t, TelemetryHistory::SteadyNowMs());
+        hub->Publish(t);
+    }
+}
+
+const std::string& RobotSession::GetId() const {
+    return id;
+}
+
+const std::string& RobotSession::GetIP() const {
+    return ip;
+}
+
+int RobotSession::GetPort() const {
+    return port;
+}
+
+ConnectionType RobotSession::GetConnectionType() const {
+    return type;
+}
+
+bool RobotSession::IsReliable() const {
+    return reliable;
+}
+
+int RobotSession::GetPollRateHz() const {
+    return poller ? poller->GetRateHz() : 0;
+}
+
+size_t RobotSession::GetQueuedCommands() const {
+    return scheduler.GetQueued();
+}
+
+uint64_t RobotSession::GetSleepsSent() const {
+    return scheduler.GetSleeps();
+}
+
+TelemetryCache& RobotSession::GetCache() {
+    return cache;
+}
+
+std::shared_ptr<TelemetryHistory> RobotSession::GetHistory() {
+    return history;
+}
+
+std::shared_ptr<TelemetryHub> RobotSession::GetHub() {
+    return hub;
+}
+
+uint64_t RobotSession::GetBytesSent() const {
+    return bytesSent.load(std::memory_order_relaxed);
+}
+
+uint64_t RobotSession::GetBytesReceived() const {
+    return dispatcher ? dispatcher->GetBytesReceived() : 0;
+}
+
+uint64_t RobotSession::GetCrcFailures() const {
+    return dispatcher ? dispatcher->GetCrcFailures() : 0;
+}
+
+uint64_t RobotSession::GetTimeouts() const {
+    return dispatcher ? dispatcher->GetTimeouts() : 0;
+}
+
+uint64_t RobotSession::GetRetransmits() const {
+    return dispatcher ? dispatcher->GetRetransmits() : 0;
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include "../MySocket/MySocket.h"
+#include "../MySocket/Reactor.h"
+#include "../PktDef/PktDef.h"
+#include "../PktDef/PktTemplate.h"
+#include "../PktDef/PktView.h"
+#include "../PktDef/SequenceAllocator.h"
+#include "CommandScheduler.h"
+#include "Executor.h"
+#include "ResponseDispatcher.h"
+#include "Task.h"
+#include "TelemetryCache.h"
+#include "TelemetryHistory.h"
+#include "TelemetryHub.h"
+#include "TelemetryPoller.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+// How a telecommand went: unless admission is SENT nothing went out, and
+// reply is empty
+struct CommandResult {
+    Admission admission;
+    Reply reply;
+};
+
+// Everything the server knows about one robot: its socket, reply dispatcher,
+// sequence numbers, telemetry cache, stream hub and poller. Sessions share
+// nothing but the Reactor thread, so requests to different robots never
+// contend. Handlers hold a shared_ptr for the length of a request, so a
+// reconnect cannot pull the socket out from under them.
+//
+// Telecommands are coroutines: co_await session->Drive(FORWARD, 1, 50, timeout)
+// suspends until the robot answers, without holding a thread, and the
+// caller carries on on the executor.
+class RobotSession : public std::enable_shared_from_this<RobotSession> {
+private:
+    std::string id;
+    std::string ip;
+    int port;
+    ConnectionType type;
+    bool reliable;
+    Reactor& reactor;
+    Executor& executor;
+    SequenceAllocator sequence;
+    CommandScheduler scheduler;
+
+    // Destroyed bottom-up: the poller and dispatcher stop using the socket
+    // before it closes, and the hub outlives anything that publishes to it
+    TelemetryCache cache;
+    std::shared_ptr<TelemetryHistory> history;
+    std::shared_ptr<TelemetryHub> hub;
+    std::unique_ptr<MySocket> socket;
+    std::unique_ptr<ResponseDispatcher> dispatcher;
+    std::unique_ptr<TelemetryPoller> poller;
+    std::atomic<uint64_t> bytesSent;
+
+    void Send(const char* raw, int length);
+    std::future<Reply> Expect(int pktCount, const char* raw, int length, std::chrono::milliseconds timeout);
+    void Expect(int pktCount, const char* raw, int length, std::chrono::milliseconds timeout, ReplyHandler done);
+
+    // Callback forms of Transact and of waiting for a turn in the scheduler
+    void TransactAsync(const char* raw, int length, int pktCount, std::chrono::milliseconds timeout, ReplyHandler done);
+    void AdmitAsync(Lane lane, AdmitHandler ready, uint64_t issuedAt);
+
+    // TransactAsync for count packets laid out back to back in arena: every
+    // reply is registered, then all of them go out in order with one syscall
+    // (sendmmsg, or one send over TCP). done gets the replies, in order,
+    // once the last one is in.
+    void TransactBatchAsync(const char* arena, const int* lengths, const uint16_t* pktCounts, int count,
+        std::chrono::milliseconds timeout, std::function<void(std::vector<Reply>)> done);
+
+    // Command for a finished frame; raw must stay put until it completes
+    Task<CommandResult> SendFrame(const char* raw, int length, int pktCount, Lane lane,
+        std::chrono::milliseconds timeout, uint64_t issuedAt = CommandScheduler::ANY_TIME);
+
+public:
+    // streams and past carry the previous session's subscribers and
+    // telemetry history over a reconnect; pass nullptr to start afresh
+    RobotSession(const std::string& robotId, const std::string& robotIP, int robotPort,
+        ConnectionType connection, Reactor& loop, Executor& pool, std::shared_ptr<TelemetryHub> streams,
+        std::shared_ptr<TelemetryHistory> past);
+
+    // Creates the socket (connecting for TCP) and starts polling at pollHz.
+    // With retransmit, UDP requests are resent until answered (see
+    // ResponseDispatcher::ExpectReliable); TCP ignores it. False if the robot
+    // could not be reached.
+    bool Open(int pollHz, bool retransmit);
+
+    // Reserves a pktCount for a packet that expects a reply; -1 when every
+    // number is still waiting on one. Transact gives it back.
+    int AcquirePktCount();
+
+    // Fills in the empty-body RESPONSE packet that asks for telemetry
+    static void BuildTelemetryRequest(PktDef& pkt, int pktCount);
+
+    // Sends a finished packet and waits for the reply with the same pktCount,
+    // then releases that pktCount. The Reply is empty on timeout.
+    Reply Transact(PktDef& pkt, std::chrono::milliseconds timeout);
+
+    // Transact for telecommands: waits for the packet's turn in the
+    // scheduler (SLEEP never waits), then for its reply, and releases the
+    // pktCount either way. Neither wait holds a thread. The session must be
+    // owned by a shared_ptr; the command keeps it alive until it finishes.
+    Task<CommandResult> Command(PktDef& pkt, std::chrono::milliseconds timeout);
+
+    // Build the packet and pick its pktCount for Command. When every
+    // pktCount is awaiting a reply the result is QUEUE_FULL. A DRIVE given
+    // issuedAt (GetSleepsSent when it was requested) is PREEMPTED if a
+    // SLEEP has gone out since.
+    Task<CommandResult> Drive(uint8_t direction, int duration, int speed, std::chrono::milliseconds timeout,
+        uint64_t issuedAt = CommandScheduler::ANY_TIME);
+    Task<CommandResult> Sleep(std::chrono::milliseconds timeout);
+
+    // Sends a run of DRIVEs as one unit: the run takes a single turn in the
+    // DRIVE lane (so a SLEEP preempts all of it or none), is stamped into one
+    // arena with a block of pktCounts, and goes out with TransactBatchAsync.
+    // Results line up with drives; any left without a pktCount are
+    // QUEUE_FULL. issuedAt is as for Drive.
+    Task<std::vector<CommandResult>> DriveBatch(std::vector<DriveBody> drives, std::chrono::milliseconds timeout,
+        uint64_t issuedAt = CommandScheduler::ANY_TIME);
+
+    // Feeds a well-formed telemetry packet to the cache, history and streams
+    void PublishTelemetry(const PktView& pkt);
+
+    const std::string& GetId() const;
+    const std::string& GetIP() const;
+    int GetPort() const;
+    ConnectionType GetConnectionType() const;
+    bool IsReliable() const;
+    int GetPollRateHz() const;
+    size_t GetQueuedCommands() const;
+    uint64_t GetSleepsSent() const;
+    TelemetryCache& GetCache();
+    std::shared_ptr<TelemetryHistory> GetHistory();
+    // Shared so WebSocket subscribers can outlive the session
+    std::shared_ptr<TelemetryHub> GetHub();
+
+    // Traffic and error counts for /metrics
+    uint64_t GetBytesSent() const;
+    uint64_t GetBytesReceived() const;
+    uint64_t GetCrcFailures() const;
+    uint64_t GetTimeouts() const;
+    uint64_t GetRetransmits() const;
+};
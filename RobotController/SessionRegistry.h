@@ -0,0 +1,91 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class RobotSession;
+
+const int REGISTRY_SHARDS = 64;
+
+// All connected robots, keyed by robot ID. The map is split into shards with
+// their own reader/writer lock, so lookups for different robots almost never
+// touch the same lock and there is no lock shared by the whole fleet.
+//
+// Session only needs GetId(), so the registry can be tested without a robot.
+template<typename Session>
+class ShardedRegistry {
+private:
+    struct Shard {
+        std::shared_mutex lock;
+        std::unordered_map<std::string, std::shared_ptr<Session>> sessions;
+    };
+
+    Shard shards[REGISTRY_SHARDS];
+
+    Shard& ShardFor(const std::string& id) {
+        return shards[std::hash<std::string>()(id) % REGISTRY_SHARDS];
+    }
+
+public:
+    // nullptr if no robot with that ID is connected
+    std::shared_ptr<Session> Find(const std::string& id) {
+        Shard& shard = ShardFor(id);
+        std::shared_lock<std::shared_mutex> guard(shard.lock);
+        auto it = shard.sessions.find(id);
+        if (it == shard.sessions.end()) return nullptr;
+        return it->second;
+    }
+
+    // Adds or replaces the session under its ID and returns the one it
+    // replaced. Let the old one go outside any lock: closing it waits for
+    // its reactor callbacks.
+    std::shared_ptr<Session> Insert(std::shared_ptr<Session> session) {
+        Shard& shard = ShardFor(session->GetId());
+        std::unique_lock<std::shared_mutex> guard(shard.lock);
+        std::shared_ptr<Session>& slot = shard.sessions[session->GetId()];
+        std::shared_ptr<Session> previous = std::move(slot);
+        slot = std::move(session);
+        return previous;
+    }
+
+    // Removes and returns the session, or nullptr if there was none
+    std::shared_ptr<Session> Remove(const std::string& id) {
+        Shard& shard = ShardFor(id);
+        std::unique_lock<std::shared_mutex> guard(shard.lock);
+        auto it = shard.sessions.find(id);
+        if (it == shard.sessions.end()) return nullptr;
+        std::shared_ptr<Session> removed = std::move(it->second);
+        shard.sessions.erase(it);
+        return removed;
+    }
+
+    // Visits every session, one shard at a time
+    void ForEach(const std::function<void(const std::shared_ptr<Session>&)>& fn) {
+        for (Shard& shard : shards) {
+            // Copy out so fn runs without the shard lock
+            std::vector<std::shared_ptr<Session>> snapshot;
+            {
+                std::shared_lock<std::shared_mutex> guard(shard.lock);
+                for (auto& entry : shard.sessions)
+                    snapshot.push_back(entry.second);
+            }
+            for (auto& session : snapshot)
+                fn(session);
+        }
+    }
+
+    int GetCount() {
+        int count = 0;
+        for (Shard& shard : shards) {
+            std::shared_lock<std::shared_mutex> guard(shard.lock);
+            count += static_cast<int>(shard.sessions.size());
+        }
+        return count;
+    }
+};
+
+typedef ShardedRegistry<RobotSession> SessionRegistry;
@@ -0,0 +1,151 @@
+#pragma once
+#include "Executor.h"
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <utility>
+
+template<typename T = void> class Task;
+
+// What Task<T> and Task<void> share: who to resume when the task finishes,
+// and the exception it finished with, if any
+class TaskPromiseBase {
+public:
+    std::coroutine_handle<> continuation;
+    std::exception_ptr error;
+
+    // Hands control straight to the awaiting coroutine, so a chain of
+    // finished tasks does not grow the stack
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> done) noexcept {
+            std::coroutine_handle<> next = done.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() { error = std::current_exception(); }
+};
+
+template<typename T>
+class TaskPromise : public TaskPromiseBase {
+public:
+    std::optional<T> value;
+
+    Task<T> get_return_object();
+    void return_value(T result) { value = std::move(result); }
+    T Take() {
+        if (error) std::rethrow_exception(error);
+        return std::move(*value);
+    }
+};
+
+template<>
+class TaskPromise<void> : public TaskPromiseBase {
+public:
+    Task<void> get_return_object();
+    void return_void() {}
+    void Take() {
+        if (error) std::rethrow_exception(error);
+    }
+};
+
+// A coroutine that produces a T. It starts when first awaited and resumes
+// its awaiter when it finishes; awaiting it again is an error. The Task
+// owns the coroutine frame.
+template<typename T>
+class Task {
+public:
+    typedef TaskPromise<T> promise_type;
+
+private:
+    std::coroutine_handle<promise_type> coroutine;
+
+public:
+    explicit Task(std::coroutine_handle<promise_type> frame) : coroutine(frame) {}
+    Task(Task&& other) noexcept : coroutine(std::exchange(other.coroutine, nullptr)) {}
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() {
+        if (coroutine) coroutine.destroy();
+    }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        coroutine.promise().continuation = awaiting;
+        return coroutine;
+    }
+    T await_resume() { return coroutine.promise().Take(); }
+};
+
+template<typename T>
+Task<T> TaskPromise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+// Suspends until a callback-style operation completes. start is handed the
+// handler to pass to the operation (ResponseDispatcher::Expect,
+// CommandScheduler::AdmitAsync, ...). If the handler runs before the
+// coroutine has finished suspending, it simply carries on; otherwise the
+// coroutine is posted to the executor, never resumed on the caller's thread.
+template<typename T>
+class CallbackAwaiter {
+private:
+    Executor& executor;
+    std::function<void(std::function<void(T)>)> start;
+    std::optional<T> result;
+    std::coroutine_handle<> waiting;
+    // Set by whichever of await_suspend and the handler finishes first
+    std::atomic<bool> done;
+
+public:
+    CallbackAwaiter(Executor& pool, std::function<void(std::function<void(T)>)> operation)
+        : executor(pool), start(std::move(operation)), done(false) {}
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> coroutine) {
+        waiting = coroutine;
+        start([this](T value) {
+            result = std::move(value);
+            if (done.exchange(true))
+                executor.Post(waiting);
+            });
+        return !done.exchange(true);
+    }
+    T await_resume() { return std::move(*result); }
+};
+
+// Fire-and-forget coroutine; its frame frees itself when it finishes
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        // As with std::thread, an exception nobody catches ends the program
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
+
+// Runs task on the executor without waiting for it
+inline Detached Spawn(Executor& executor, Task<void> task) {
+    co_await executor.Schedule();
+    co_await std::move(task);
+}
+
+// Runs task on the calling thread until it first suspends, then lets it
+// finish wherever it is resumed. Tasks started one after another this way
+// reach their first wait (e.g. a scheduler admission) in that order.
+inline Detached Start(Task<void> task) {
+    co_await std::move(task);
+}
@@ -0,0 +1,64 @@
+#include "TelemetryCache.h"
+#include <chrono>
+
+static int64_t SteadyNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+TelemetryCache::TelemetryCache()
+    : sequence(0), packed(0), speed(0), samples(0), receivedAtMs(0), receivedAtNs(0) {}
+
+void TelemetryCache::Store(const Telemetry& t) {
+    uint64_t word = static_cast<uint64_t>(t.lastPktCounter)
+        | (static_cast<uint64_t>(t.currentGrade) << 16)
+        | (static_cast<uint64_t>(t.hitCount) << 32)
+        | (static_cast<uint64_t>(t.lastCmd) << 48)
+        | (static_cast<uint64_t>(t.lastCmdValue) << 56);
+    int64_t wallMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    std::lock_guard<std::mutex> guard(writeLock);
+
+    // Odd sequence marks a write in progress
+    uint32_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    packed.store(word, std::memory_order_relaxed);
+    speed.store(t.lastCmdSpeed, std::memory_order_relaxed);
+    samples.store(samples.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    receivedAtMs.store(wallMs, std::memory_order_relaxed);
+    receivedAtNs.store(SteadyNowNs(), std::memory_order_relaxed);
+
+    sequence.store(seq + 2, std::memory_order_release);
+}
+
+bool TelemetryCache::Load(Telemetry& out, int64_t& ageMs, uint64_t& count, int64_t& timestampMs) const {
+    uint64_t word;
+    uint8_t spd;
+    int64_t atNs;
+    while (true) {
+        uint32_t before = sequence.load(std::memory_order_acquire);
+        if (before & 1) continue;
+
+        word = packed.load(std::memory_order_relaxed);
+        spd = speed.load(std::memory_order_relaxed);
+        count = samples.load(std::memory_order_relaxed);
+        timestampMs = receivedAtMs.load(std::memory_order_relaxed);
+        atNs = receivedAtNs.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence.load(std::memory_order_relaxed) == before) break;
+    }
+    if (count == 0) return false;
+
+    out.lastPktCounter = static_cast<uint16_t>(word);
+    out.currentGrade = static_cast<uint16_t>(word >> 16);
+    out.hitCount = static_cast<uint16_t>(word >> 32);
+    out.lastCmd = static_cast<uint8_t>(word >> 48);
+    out.lastCmdValue = static_cast<uint8_t>(word >> 56);
+    out.lastCmdSpeed = spd;
+    ageMs = (SteadyNowNs() - atNs) / 1000000;
+    return true;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include "../PktDef/PktDef.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+// Latest telemetry sample behind a seqlock. Writers (the receive path) are
+// serialized by a mutex; any number of HTTP handlers read without taking a
+// lock and never block a writer.
+class TelemetryCache {
+private:
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint64_t> packed;       // lastPkt | grade | hits | cmd | value
+    std::atomic<uint8_t> speed;
+    std::atomic<uint64_t> samples;
+    std::atomic<int64_t> receivedAtMs;  // wall clock
+    std::atomic<int64_t> receivedAtNs;  // steady clock, for age
+    std::mutex writeLock;
+
+public:
+    TelemetryCache();
+
+    void Store(const Telemetry& t);
+
+    // Copies the newest sample; false if none has arrived yet.
+    // ageMs is how long ago it was received, count how many samples so far.
+    bool Load(Telemetry& out, int64_t& ageMs, uint64_t& count, int64_t& timestampMs) const;
+};
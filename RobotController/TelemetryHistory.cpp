@@ -0,0 +1,164 @@
+#include "TelemetryHistory.h"
+
+const int64_t SECOND_MS = 1000;
+const int64_t MINUTE_MS = 60000;
+
+TelemetryHistory::StatsColumns::StatsColumns(int rows)
+    : min(new std::atomic<uint16_t>[rows]),
+    max(new std::atomic<uint16_t>[rows]),
+    mean(new std::atomic<float>[rows]) {}
+
+void TelemetryHistory::StatsColumns::Store(int slot, const Accumulator& a, uint32_t count) {
+    min[slot].store(a.min, std::memory_order_relaxed);
+    max[slot].store(a.max, std::memory_order_relaxed);
+    mean[slot].store(static_cast<float>(a.sum) / count, std::memory_order_relaxed);
+}
+
+void TelemetryHistory::StatsColumns::Load(int slot, FieldStats& out) const {
+    out.min.push_back(min[slot].load(std::memory_order_relaxed));
+    out.max.push_back(max[slot].load(std::memory_order_relaxed));
+    out.mean.push_back(mean[slot].load(std::memory_order_relaxed));
+}
+
+TelemetryHistory::Ring::Ring(int rows)
+    : capacity(rows),
+    timestampMs(new std::atomic<int64_t>[rows]),
+    lastPktCounter(new std::atomic<uint16_t>[rows]),
+    currentGrade(new std::atomic<uint16_t>[rows]),
+    hitCount(new std::atomic<uint16_t>[rows]),
+    lastCmd(new std::atomic<uint8_t>[rows]),
+    lastCmdValue(new std::atomic<uint8_t>[rows]),
+    lastCmdSpeed(new std::atomic<uint8_t>[rows]),
+    grade(rows), hits(rows), speed(rows),
+    samples(new std::atomic<uint32_t>[rows]),
+    head(0), writing(0) {}
+
+void TelemetryHistory::Ring::Push(int64_t atMs, const Bucket& b) {
+    uint64_t row = head.load(std::memory_order_relaxed);
+    // Announce the overwrite before doing it; pairs with the fence in Read
+    writing.store(row + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    int slot = static_cast<int>(row % capacity);
+    timestampMs[slot].store(atMs, std::memory_order_relaxed);
+    lastPktCounter[slot].store(b.last.lastPktCounter, std::memory_order_relaxed);
+    currentGrade[slot].store(b.last.currentGrade, std::memory_order_relaxed);
+    hitCount[slot].store(b.last.hitCount, std::memory_order_relaxed);
+    lastCmd[slot].store(b.last.lastCmd, std::memory_order_relaxed);
+    lastCmdValue[slot].store(b.last.lastCmdValue, std::memory_order_relaxed);
+    lastCmdSpeed[slot].store(b.last.lastCmdSpeed, std::memory_order_relaxed);
+    grade.Store(slot, b.grade, b.count);
+    hits.Store(slot, b.hits, b.count);
+    speed.Store(slot, b.speed, b.count);
+    samples[slot].store(b.count, std::memory_order_relaxed);
+    head.store(row + 1, std::memory_order_release);
+}
+
+void TelemetryHistory::Ring::Read(int64_t fromMs, int64_t toMs, TelemetrySeries& out) const {
+    uint64_t end = head.load(std::memory_order_acquire);
+    uint64_t begin = end > static_cast<uint64_t>(capacity) ? end - capacity : 0;
+
+    // Scan the timestamp column first and copy only the rows that match
+    std::vector<uint64_t> rows;
+    for (uint64_t row = begin; row < end; ++row) {
+        int64_t at = timestampMs[row % capacity].load(std::memory_order_relaxed);
+        if (at >= fromMs && at <= toMs) rows.push_back(row);
+    }
+    size_t first = out.timestampMs.size();
+    for (uint64_t row : rows) {
+        int slot = static_cast<int>(row % capacity);
+        out.timestampMs.push_back(timestampMs[slot].load(std::memory_order_relaxed));
+        out.lastPktCounter.push_back(lastPktCounter[slot].load(std::memory_order_relaxed));
+        out.currentGrade.push_back(currentGrade[slot].load(std::memory_order_relaxed));
+        out.hitCount.push_back(hitCount[slot].load(std::memory_order_relaxed));
+        out.lastCmd.push_back(lastCmd[slot].load(std::memory_order_relaxed));
+        out.lastCmdValue.push_back(lastCmdValue[slot].load(std::memory_order_relaxed));
+        out.lastCmdSpeed.push_back(lastCmdSpeed[slot].load(std::memory_order_relaxed));
+        grade.Load(slot, out.grade);
+        hits.Load(slot, out.hits);
+        speed.Load(slot, out.speed);
+        out.samples.push_back(samples[slot].load(std::memory_order_relaxed));
+    }
+
+    // Rows the writer reached while we copied may hold newer data; drop them
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t reached = writing.load(std::memory_order_relaxed);
+    uint64_t oldestIntact = reached > static_cast<uint64_t>(capacity) ? reached - capacity : 0;
+    size_t torn = 0;
+    while (torn < rows.size() && rows[torn] < oldestIntact) ++torn;
+    if (torn == 0) return;
+    auto drop = [first, torn](auto& column) {
+        column.erase(column.begin() + first, column.begin() + first + torn);
+    };
+    drop(out.timestampMs);
+    drop(out.lastPktCounter);
+    drop(out.currentGrade);
+    drop(out.hitCount);
+    drop(out.lastCmd);
+    drop(out.lastCmdValue);
+    drop(out.lastCmdSpeed);
+    for (FieldStats* stats : { &out.grade, &out.hits, &out.speed }) {
+        drop(stats->min);
+        drop(stats->max);
+        drop(stats->mean);
+    }
+    drop(out.samples);
+}
+
+TelemetryHistory::TelemetryHistory()
+    : raw(HISTORY_RAW), seconds(HISTORY_SECONDS), minutes(HISTORY_MINUTES),
+    openSecond{ -1, {} }, openMinute{ -1, {} } {}
+
+// Starts a bucket holding just t
+void TelemetryHistory::Open(Bucket& b, const Telemetry& t) {
+    b.last = t;
+    b.grade.Reset(t.currentGrade);
+    b.hits.Reset(t.hitCount);
+    b.speed.Reset(t.lastCmdSpeed);
+    b.count = 1;
+}
+
+// Folds a sample into the open bucket, first closing it into ring if the
+// sample belongs to a later bucket
+void TelemetryHistory::Roll(Ring& ring, OpenBucket& open, int64_t widthMs, int64_t atMs, const Telemetry& t) {
+    int64_t start = atMs - atMs % widthMs;
+    if (open.b.count > 0 && start != open.startMs) {
+        ring.Push(open.startMs, open.b);
+        open.b.count = 0;
+    }
+    if (open.b.count == 0) {
+        open.startMs = start;
+        Open(open.b, t);
+        return;
+    }
+    open.b.last = t;
+    open.b.grade.Add(t.currentGrade);
+    open.b.hits.Add(t.hitCount);
+    open.b.speed.Add(t.lastCmdSpeed);
+    open.b.count++;
+}
+
+void TelemetryHistory::Append(const Telemetry& t, int64_t atMs) {
+    std::lock_guard<std::mutex> guard(writeLock);
+    Bucket sample;
+    Open(sample, t);
+    raw.Push(atMs, sample);
+    Roll(seconds, openSecond, SECOND_MS, atMs, t);
+    Roll(minutes, openMinute, MINUTE_MS, atMs, t);
+}
+
+void TelemetryHistory::Query(Resolution res, int64_t fromMs, int64_t toMs, TelemetrySeries& out) const {
+    const Ring& ring = res == Resolution::RAW ? raw : res == Resolution::SECOND ? seconds : minutes;
+    ring.Read(fromMs, toMs, out);
+}
+
+int64_t TelemetryHistory::SteadyNowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t TelemetryHistory::WallOffsetMs() {
+    int64_t wall = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    return wall - SteadyNowMs();
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include "../PktDef/PktDef.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Samples kept at each resolution: about 100 s of raw telemetry at the
+// default 20 Hz, 15 minutes of 1 s buckets and a day of 1 minute buckets
+const int HISTORY_RAW = 2048;
+const int HISTORY_SECONDS = 900;
+const int HISTORY_MINUTES = 1440;
+
+enum class Resolution { RAW, SECOND, MINUTE };
+
+// Min, max and mean of one field over a bucket; a raw sample is a bucket
+// of one, so all three are its value
+struct FieldStats {
+    std::vector<uint16_t> min;
+    std::vector<uint16_t> max;
+    std::vector<float> mean;
+};
+
+// Query result, one vector per field. The packet counter and the last
+// command are state, so a bucket reports their last value; grade, hits and
+// speed are measurements and get min/max/mean too. samples is how many
+// telemetry packets a bucket covered (always 1 for raw samples).
+struct TelemetrySeries {
+    std::vector<int64_t> timestampMs;
+    std::vector<uint16_t> lastPktCounter;
+    std::vector<uint16_t> currentGrade;
+    std::vector<uint16_t> hitCount;
+    std::vector<uint8_t> lastCmd;
+    std::vector<uint8_t> lastCmdValue;
+    std::vector<uint8_t> lastCmdSpeed;
+    FieldStats grade;
+    FieldStats hits;
+    FieldStats speed;
+    std::vector<uint32_t> samples;
+};
+
+// One robot's telemetry over time, at three resolutions, so dashboards can
+// graph it without asking the robot again. Each resolution is a fixed ring
+// stored column by column, so a range scan reads only the timestamp column
+// until it finds matches. Writers are serialized by a mutex; readers take
+// no lock and never hold up a writer: they copy what they need and then
+// drop any rows that were overwritten while they were copying.
+//
+// A 1 s or 1 min bucket becomes visible once it is closed by the first
+// sample after it, so the coarse series run up to one bucket behind.
+//
+// Times in here are steady-clock ms, so buckets stay put when the wall
+// clock is adjusted; callers convert with WallOffsetMs() at the edges.
+class TelemetryHistory {
+private:
+    // Running min/max/sum of one field
+    struct Accumulator {
+        uint16_t min;
+        uint16_t max;
+        uint64_t sum;
+
+        void Reset(uint16_t v) { min = max = v; sum = v; }
+        void Add(uint16_t v) { if (v < min) min = v; if (v > max) max = v; sum += v; }
+    };
+
+    // A bucket ready to be stored: the last sample plus its measurements
+    struct Bucket {
+        Telemetry last;
+        Accumulator grade;
+        Accumulator hits;
+        Accumulator speed;
+        uint32_t count;
+    };
+
+    // Columns for one FieldStats
+    struct StatsColumns {
+        std::unique_ptr<std::atomic<uint16_t>[]> min;
+        std::unique_ptr<std::atomic<uint16_t>[]> max;
+        std::unique_ptr<std::atomic<float>[]> mean;
+
+        explicit StatsColumns(int rows);
+        void Store(int slot, const Accumulator& a, uint32_t count);
+        void Load(int slot, FieldStats& out) const;
+    };
+
+    class Ring {
+    private:
+        int capacity;
+        std::unique_ptr<std::atomic<int64_t>[]> timestampMs;
+        std::unique_ptr<std::atomic<uint16_t>[]> lastPktCounter;
+        std::unique_ptr<std::atomic<uint16_t>[]> currentGrade;
+        std::unique_ptr<std::atomic<uint16_t>[]> hitCount;
+        std::unique_ptr<std::atomic<uint8_t>[]> lastCmd;
+        std::unique_ptr<std::atomic<uint8_t>[]> lastCmdValue;
+        std::unique_ptr<std::atomic<uint8_t>[]> lastCmdSpeed;
+        StatsColumns grade;
+        StatsColumns hits;
+        StatsColumns speed;
+        std::unique_ptr<std::atomic<uint32_t>[]> samples;
+        std::atomic<uint64_t> head;     // rows published
+        std::atomic<uint64_t> writing;  // one past the row being written
+
+    public:
+        explicit Ring(int rows);
+        void Push(int64_t atMs, const Bucket& b);
+        void Read(int64_t fromMs, int64_t toMs, TelemetrySeries& out) const;
+    };
+
+    // A coarse bucket still collecting samples; only writers touch it
+    struct OpenBucket {
+        int64_t startMs;
+        Bucket b;
+    };
+
+    Ring raw;
+    Ring seconds;
+    Ring minutes;
+    OpenBucket openSecond;
+    OpenBucket openMinute;
+    std::mutex writeLock;
+
+    static void Open(Bucket& b, const Telemetry& t);
+    static void Roll(Ring& ring, OpenBucket& open, int64_t widthMs, int64_t atMs, const Telemetry& t);
+
+public:
+    TelemetryHistory();
+
+    // Adds a sample received at atMs (steady clock ms, see SteadyNowMs)
+    void Append(const Telemetry& t, int64_t atMs);
+
+    // Samples with fromMs <= timestamp <= toMs (steady clock ms), oldest first
+    void Query(Resolution res, int64_t fromMs, int64_t toMs, TelemetrySeries& out) const;
+
+    static int64_t SteadyNowMs();
+
+    // Add to a steady time to get ms since the epoch as the wall clock
+    // reads now; subtract to go the other way
+    static int64_t WallOffsetMs();
+};
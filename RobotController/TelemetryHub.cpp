@@ -0,0 +1,162 @@
+#include "TelemetryHub.h"
+#include <cstdio>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+TelemetryHub::TelemetryHub() : running(true) {
+    latest = TelemetrySample{ Telemetry{}, 0, 0 };
+}
+
+TelemetryHub::~TelemetryHub() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        running = false;
+    }
+    wake.notify_all();
+    if (broadcaster.joinable()) broadcaster.join();
+}
+
+void TelemetryHub::Publish(const Telemetry& t) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        latest.data = t;
+        latest.seq++;
+        latest.timestampMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+    wake.notify_all();
+}
+
+TelemetrySample TelemetryHub::GetLatest() {
+    std::lock_guard<std::mutex> guard(lock);
+    return latest;
+}
+
+void TelemetryHub::Subscribe(const void* key, Sink sink) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        subscribers[key] = Subscriber{ std::move(sink), DEFAULT_STREAM_HZ, false, 0, Clock::now(), false };
+        // Robots nobody is watching never get a broadcaster thread
+        if (!broadcaster.joinable())
+            broadcaster = std::thread(&TelemetryHub::Run, this);
+    }
+    wake.notify_all();
+}
+
+void TelemetryHub::Configure(const void* key, int maxHz, bool binary) {
+    if (maxHz < 1) maxHz = 1;
+    if (maxHz > MAX_STREAM_HZ) maxHz = MAX_STREAM_HZ;
+
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = subscribers.find(key);
+    if (it == subscribers.end()) return;
+    it->second.maxHz = maxHz;
+    it->second.binary = binary;
+}
+
+void TelemetryHub::Unsubscribe(const void* key) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        subscribers.erase(key);
+    }
+    // Wait out a broadcast that may have picked this sink up already
+    std::lock_guard<std::mutex> wait(sinkLock);
+}
+
+// The subscriber's last frame is out; it may have the next one
+void TelemetryHub::Written(const void* key) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = subscribers.find(key);
+        if (it == subscribers.end()) return;
+        it->second.sending = false;
+    }
+    wake.notify_all();
+}
+
+int TelemetryHub::GetSubscriberCount() {
+    std::lock_guard<std::mutex> guard(lock);
+    return static_cast<int>(subscribers.size());
+}
+
+void TelemetryHub::Run() {
+    struct Delivery {
+        Sink sink;
+        const std::string* frame;
+        bool binary;
+        std::function<void()> written;
+    };
+    std::weak_ptr<TelemetryHub> self = weak_from_this();
+    std::vector<Delivery> due;
+    std::string json, binary;
+
+    std::unique_lock<std::mutex> guard(lock);
+    while (running) {
+        auto now = Clock::now();
+
+        // Pick the subscribers due the newest sample: not rate-limited and
+        // with nothing still unwritten
+        json.clear();
+        binary.clear();
+        Clock::time_point wakeAt = now + std::chrono::seconds(1);
+        for (auto& entry : subscribers) {
+            Subscriber& sub = entry.second;
+            if (sub.lastSeq >= latest.seq || sub.sending) continue;
+            if (now < sub.nextSend) {
+                if (sub.nextSend < wakeAt) wakeAt = sub.nextSend;
+                continue;
+            }
+
+            std::string& frame = sub.binary ? binary : json;
+            if (frame.empty()) frame = sub.binary ? ToBinary(latest) : ToJson(latest);
+            const void* key = entry.first;
+            due.push_back(Delivery{ sub.sink, &frame, sub.binary, [self, key]() {
+                if (std::shared_ptr<TelemetryHub> hub = self.lock()) hub->Written(key);
+                } });
+            sub.sending = true;
+            sub.lastSeq = latest.seq;
+            sub.nextSend = now + std::chrono::milliseconds(1000 / sub.maxHz);
+        }
+
+        if (!due.empty()) {
+            // Sinks run without lock, so Publish and Written never wait on
+            // them; sinkLock keeps Unsubscribe from returning mid-call
+            std::lock_guard<std::mutex> calling(sinkLock);
+            guard.unlock();
+            for (Delivery& d : due)
+                d.sink(*d.frame, d.binary, std::move(d.written));
+            due.clear();
+            guard.lock();
+            continue;
+        }
+
+        wake.wait_until(guard, wakeAt);
+    }
+}
+
+std::string TelemetryHub::ToJson(const TelemetrySample& s) {
+    char buf[192];
+    int n = snprintf(buf, sizeof(buf),
+        "{\"seq\":%llu,\"ts\":%lld,\"lastPkt\":%u,\"grade\":%u,\"hits\":%u,\"lastCmd\":%u,\"lastValue\":%u,\"speed\":%u}",
+        static_cast<unsigned long long>(s.seq), static_cast<long long>(s.timestampMs),
+        s.data.lastPktCounter, s.data.currentGrade, s.data.hitCount,
+        s.data.lastCmd, s.data.lastCmdValue, s.data.lastCmdSpeed);
+    return std::string(buf, n);
+}
+
+std::string TelemetryHub::ToBinary(const TelemetrySample& s) {
+    unsigned char out[13];
+    uint32_t seq = static_cast<uint32_t>(s.seq);
+    for (int i = 0; i < 4; ++i) out[i] = static_cast<unsigned char>(seq >> (8 * i));
+    out[4] = s.data.lastPktCounter & 0xFF;
+    out[5] = s.data.lastPktCounter >> 8;
+    out[6] = s.data.currentGrade & 0xFF;
+    out[7] = s.data.currentGrade >> 8;
+    out[8] = s.data.hitCount & 0xFF;
+    out[9] = s.data.hitCount >> 8;
+    out[10] = s.data.lastCmd;
+    out[11] = s.data.lastCmdValue;
+    out[12] = s.data.lastCmdSpeed;
+    return std::string(reinterpret_cast<char*>(out), sizeof(out));
+}
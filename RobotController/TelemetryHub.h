@@ -0,0 +1,80 @@
+#pragma once
+#include "../PktDef/PktDef.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+const int DEFAULT_STREAM_HZ = 20;
+const int MAX_STREAM_HZ = 100;
+
+// One telemetry reading as it left the robot
+struct TelemetrySample {
+    Telemetry data;
+    uint64_t seq;        // 0 = no sample yet
+    int64_t timestampMs; // wall clock, ms since epoch
+};
+
+// Fans the latest telemetry sample out to streaming subscribers (the GUI's
+// WebSocket). Each subscriber gets at most maxHz frames per second and only
+// ever the newest sample, and is given no new frame until it reports the
+// last one written: anything published meanwhile is coalesced away, so a
+// slow or stalled browser cannot build up a backlog.
+//
+// Must be owned by a shared_ptr, which the written callbacks hold weakly.
+class TelemetryHub : public std::enable_shared_from_this<TelemetryHub> {
+public:
+    // Delivers one encoded frame (binary frames use the layout from
+    // ToBinary) and calls written once it has left the process, or failed
+    typedef std::function<void(const std::string& frame, bool binary, std::function<void()> written)> Sink;
+
+private:
+    struct Subscriber {
+        Sink sink;
+        int maxHz;
+        bool binary;
+        uint64_t lastSeq;
+        std::chrono::steady_clock::time_point nextSend;
+        // A frame was handed to the sink and not yet written
+        bool sending;
+    };
+
+    std::mutex lock;
+    // Held by the broadcaster while it calls sinks, outside lock
+    std::mutex sinkLock;
+    std::condition_variable wake;
+    std::unordered_map<const void*, Subscriber> subscribers;
+    TelemetrySample latest;
+    bool running;
+
+    std::thread broadcaster;     // started by the first Subscribe
+
+    void Run();
+    void Written(const void* key);
+
+public:
+    TelemetryHub();
+    ~TelemetryHub();
+
+    // Records a new sample and wakes the broadcaster
+    void Publish(const Telemetry& t);
+    TelemetrySample GetLatest();
+
+    // key identifies the subscriber (e.g. its connection) for later calls
+    void Subscribe(const void* key, Sink sink);
+    void Configure(const void* key, int maxHz, bool binary);
+    // Once this returns the sink will not be called again
+    void Unsubscribe(const void* key);
+    int GetSubscriberCount();
+
+    // {"seq":..,"ts":..,"lastPkt":..,"grade":..,"hits":..,"lastCmd":..,"lastValue":..,"speed":..}
+    static std::string ToJson(const TelemetrySample& s);
+
+    // 13 bytes, little-endian: seq(4) lastPkt(2) grade(2) hits(2) cmd(1) value(1) speed(1)
+    static std::string ToBinary(const TelemetrySample& s);
+};
@@ -0,0 +1,35 @@
+#include "TelemetryPoller.h"
+
+TelemetryPoller::TelemetryPoller(Reactor& loop, std::function<void()> request, int rateHz)
+    : reactor(loop), sendRequest(std::move(request)), periodMs(0), running(rateHz > 0), timer(0)
+{
+    if (rateHz > 0) {
+        periodMs = rateHz >= 1000 ? 1 : 1000 / rateHz;
+        Reactor::TimerId first = reactor.RunAfter(std::chrono::milliseconds(0), [this]() { Tick(); });
+        // The first tick may already have run and re-armed; keep its newer id
+        Reactor::TimerId unset = 0;
+        timer.compare_exchange_strong(unset, first);
+    }
+}
+
+TelemetryPoller::~TelemetryPoller() {
+    running = false;
+    // A tick that was already running may have re-armed itself; cancel
+    // until the timer id stops changing
+    Reactor::TimerId id;
+    do {
+        id = timer.load();
+        reactor.CancelTimer(id);
+    } while (timer.load() != id);
+}
+
+int TelemetryPoller::GetRateHz() const {
+    int period = periodMs.load();
+    return period > 0 ? 1000 / period : 0;
+}
+
+void TelemetryPoller::Tick() {
+    if (!running) return;
+    sendRequest();
+    timer = reactor.RunAfter(std::chrono::milliseconds(periodMs.load()), [this]() { Tick(); });
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "../MySocket/Reactor.h"
+#include <atomic>
+#include <functional>
+
+const int DEFAULT_POLL_HZ = 20;
+
+// Asks one robot for telemetry at a fixed rate from the shared Reactor
+// thread, so polling any number of robots costs no extra threads. The
+// request is fire-and-forget: the reply comes back through the dispatcher.
+class TelemetryPoller {
+private:
+    Reactor& reactor;
+    std::function<void()> sendRequest;
+    std::atomic<int> periodMs;
+    std::atomic<bool> running;
+    std::atomic<Reactor::TimerId> timer;
+
+    void Tick();
+
+public:
+    // rateHz <= 0 creates a stopped poller
+    TelemetryPoller(Reactor& loop, std::function<void()> request, int rateHz);
+    ~TelemetryPoller();
+
+    int GetRateHz() const;
+};
@@ -1,156 +1,918 @@
 #include "crow_all.h"
 #include "../MySocket/MySocket.h"
+#include "../PktDef/PacketPool.h"
 #include "../PktDef/PktDef.h"
+#include "../PktDef/PktView.h"
+#include "AssetCache.h"
+#include "Executor.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "RobotSession.h"
+#include "SessionRegistry.h"
+#include "Task.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <memory>
-#include <fstream>
 #include <sstream>
-#include <iostream>
 #include <thread>
+#include <utility>
+#include <vector>
 
-std::unique_ptr<MySocket> udpSocket = nullptr;
-std::string robotIP = "";
-int robotPort = 0;
-ConnectionType connectionType = ConnectionType::UDP;
-int pktCounter = 1;
+// ROBOT_IO_BACKEND=epoll opts out of io_uring, which is otherwise used
+// wherever the kernel supports it
+IoBackend ChooseBackend() {
+    const char* name = std::getenv("ROBOT_IO_BACKEND");
+    return name && std::string(name) == "epoll" ? IoBackend::EPOLL : IoBackend::IO_URING;
+}
 
-int main() {
-    crow::SimpleApp app;
+// Shared by every session: one thread services all robot sockets and timers
+Reactor ioReactor(ChooseBackend());
 
-    // Route to serve index.html
-    CROW_ROUTE(app, "/").methods("GET"_method)([]() {
-        std::ifstream file("static/index.html");
-        if (!file.is_open()) return crow::response(500, "index.html not found.");
-        std::stringstream buf;
-        buf << file.rdbuf();
-        auto res = crow::response(buf.str());
-        res.set_header("Content-Type", "text/html");
+// Resumes telecommand coroutines once the reactor thread has their reply.
+// Declared after the reactor, which posts to it, and before the sessions
+// that waiting coroutines hold.
+Executor robotExecutor;
+
+// Declared after the reactor so sessions are closed while it still runs
+SessionRegistry sessions;
+
+// The unprefixed routes (/connect, /telecommand/, ...) drive this robot
+const std::string DEFAULT_ROBOT_ID = "default";
+
+// GUI files, loaded once at startup
+AssetCache assets("static");
+
+// HTTP port for the GUI and API
+const int SERVER_PORT = 18080;
+
+// How long a handler waits for the robot's reply unless the request overrides it
+const std::chrono::milliseconds DEFAULT_REPLY_TIMEOUT(500);
+// Longest reply timeout a request may ask for
+const std::chrono::milliseconds MAX_REPLY_TIMEOUT(10000);
+
+// Telemetry handlers still block on robot replies, so run more HTTP
+// workers than cores; commands wait without holding one
+const int MIN_HTTP_WORKERS = 32;
+
+// Largest /telecommand/batch request
+const int MAX_BATCH_COMMANDS = 256;
+
+// Longest /robots/<id>/maneuver request
+const int MAX_MANEUVER_STEPS = 64;
+
+// Crow's own messages, including a line per request, go through the
+// asynchronous logger instead of blocking on std::clog
+class CrowLogBridge : public crow::ILogHandler {
+public:
+    void log(std::string message, crow::LogLevel level) override {
+        switch (level) {
+        case crow::LogLevel::Debug: LOG_DEBUG("{}", message); break;
+        case crow::LogLevel::Info: LOG_INFO("{}", message); break;
+        case crow::LogLevel::Warning: LOG_WARN("{}", message); break;
+        default: LOG_ERROR("{}", message); break;
+        }
+    }
+};
+
+// A response that is finished after its handler has returned. Crow wants
+// end() called on the connection's own I/O thread, so Send posts it there.
+struct AsyncResponse {
+    asio::io_service* io;
+    crow::response* res;
+
+    void Send(crow::response result) const {
+        crow::response* target = res;
+        asio::post(*io, [target, reply = std::move(result)]() mutable {
+            *target = std::move(reply);
+            target->end();
+            });
+    }
+};
+
+// Times every HTTP handler into the HTTP_HANDLER histogram. Async routes
+// answer after their handler returns, so their full wait for the robot goes
+// to HTTP_ASYNC instead.
+struct HandlerTimer {
+    struct context {
+        Metrics::Clock::time_point start;
+        bool responded;
+        // The handler returned before the response was ready
+        bool async;
+    };
+
+    void before_handle(crow::request&, crow::response&, context& ctx) {
+        ctx.start = Metrics::Clock::now();
+        ctx.responded = false;
+        ctx.async = false;
+    }
+
+    // Called by async routes as their handler returns; a response already
+    // sent from inside the handler (a 400, say) was timed as usual
+    static void HandlerReturned(context& ctx) {
+        if (ctx.responded) return;
+        Metrics::Record(Histogram::HTTP_HANDLER, ctx.start);
+        ctx.async = true;
+    }
+
+    void after_handle(crow::request&, crow::response&, context& ctx) {
+        ctx.responded = true;
+        Metrics::Record(ctx.async ? Histogram::HTTP_ASYNC : Histogram::HTTP_HANDLER, ctx.start);
+    }
+};
+
+// Text body used by /telementry_request/
+std::string FormatTelemetry(const Telemetry& t) {
+    std::ostringstream oss;
+    oss << "LastPkt: " << t.lastPktCounter << "\n";
+    oss << "Grade: " << t.currentGrade << "\n";
+    oss << "HitCount: " << t.hitCount << "\n";
+    oss << "LastCmd: " << static_cast<int>(t.lastCmd) << "\n";
+    oss << "LastValue: " << static_cast<int>(t.lastCmdValue) << "\n";
+    oss << "Speed: " << static_cast<int>(t.lastCmdSpeed) << "\n";
+    return oss.str();
+}
+
+// Answers from the in-memory asset table: 304 when the browser's copy is
+// current, otherwise the smallest encoding it accepts
+crow::response ServeAsset(const crow::request& req, const std::string& name) {
+    std::shared_ptr<const Asset> asset = assets.Find(name);
+    if (!asset) return crow::response(404);
+
+    AssetBody chosen = AssetCache::Select(*asset, req.get_header_value("Accept-Encoding"));
+    crow::response res;
+    res.set_header("ETag", *chosen.etag);
+    res.set_header("Cache-Control", "no-cache");
+    res.set_header("Vary", "Accept-Encoding");
+    if (AssetCache::Matches(req.get_header_value("If-None-Match"), *chosen.etag)) {
+        res.code = 304;
         return res;
+    }
+    res.set_header("Content-Type", asset->contentType);
+    if (chosen.encoding) res.set_header("Content-Encoding", chosen.encoding);
+    res.body = *chosen.body;
+    return res;
+}
+
+// Lists the connected robots as JSON
+crow::response ListRobots() {
+    std::vector<crow::json::wvalue> robots;
+    sessions.ForEach([&robots](const std::shared_ptr<RobotSession>& session) {
+        crow::json::wvalue robot;
+        robot["id"] = session->GetId();
+        robot["ip"] = session->GetIP();
+        robot["port"] = session->GetPort();
+        robot["protocol"] = session->GetConnectionType() == ConnectionType::TCP ? "TCP" : "UDP";
+        robot["reliable"] = session->IsReliable();
+        robot["telemetryHz"] = session->GetPollRateHz();
+        robot["queuedCommands"] = session->GetQueuedCommands();
+        robots.push_back(std::move(robot));
         });
+    crow::json::wvalue body;
+    body["robots"] = std::move(robots);
+    return crow::response(200, body);
+}
 
-    // Serve CSS and JS
-    CROW_ROUTE(app, "/<string>").methods("GET"_method)
-        ([](const crow::request&, std::string filename) {
-        std::ifstream file("static/" + filename);
-        if (!file.is_open()) return crow::response(404);
-        std::stringstream buf;
-        buf << file.rdbuf();
-        crow::response res(buf.str());
-        if (filename.find(".css") != std::string::npos)
-            res.set_header("Content-Type", "text/css");
-        else if (filename.find(".js") != std::string::npos)
-            res.set_header("Content-Type", "application/javascript");
-        return res;
-            });
+// Robot IDs come from URLs, so quote them as Prometheus label values
+std::string LabelValue(const std::string& id) {
+    std::string out;
+    for (char c : id) {
+        if (c == '\\' || c == '"') out += '\\';
+        if (c == '\n') { out += "\\n"; continue; }
+        out += c;
+    }
+    return out;
+}
 
-    // Handle connection to robot
-    CROW_ROUTE(app, "/connect").methods("POST"_method)([](const crow::request& req) {
-        auto body = crow::json::load(req.body);
-        if (!body) return crow::response(400, "Invalid JSON");
-
-        robotIP = body["ip"].s();
-        robotPort = body["port"].i();
-        std::string protocol = body["protocol"].s();
-        connectionType = (protocol == "TCP") ? ConnectionType::TCP : ConnectionType::UDP;
-
-        std::cout << "[DEBUG] Connecting to robot at " << robotIP << ":" << robotPort
-            << " using " << protocol << std::endl;
-
-        try {
-            udpSocket = std::make_unique<MySocket>(
-                SocketType::CLIENT,
-                robotIP,
-                robotPort,
-                connectionType,
-                1024
-            );
-            return crow::response(200, "Connected to " + robotIP + ":" + std::to_string(robotPort));
+// Server-wide metrics followed by per-robot counters
+std::string RenderMetrics() {
+    std::ostringstream bytesIn, bytesOut, crcFailures, timeouts, retransmits;
+    sessions.ForEach([&](const std::shared_ptr<RobotSession>& session) {
+        std::string label = "{robot=\"" + LabelValue(session->GetId()) + "\"} ";
+        bytesIn << "robotcontroller_robot_bytes_in_total" << label << session->GetBytesReceived() << "\n";
+        bytesOut << "robotcontroller_robot_bytes_out_total" << label << session->GetBytesSent() << "\n";
+        crcFailures << "robotcontroller_robot_crc_failures_total" << label << session->GetCrcFailures() << "\n";
+        timeouts << "robotcontroller_robot_timeouts_total" << label << session->GetTimeouts() << "\n";
+        retransmits << "robotcontroller_robot_retransmits_total" << label << session->GetRetransmits() << "\n";
+        });
+
+    std::string out = Metrics::RenderPrometheus();
+    out += "# HELP robotcontroller_robot_bytes_in_total Bytes received from each robot\n"
+        "# TYPE robotcontroller_robot_bytes_in_total counter\n" + bytesIn.str();
+    out += "# HELP robotcontroller_robot_bytes_out_total Bytes sent to each robot\n"
+        "# TYPE robotcontroller_robot_bytes_out_total counter\n" + bytesOut.str();
+    out += "# HELP robotcontroller_robot_crc_failures_total Packets from each robot with a bad CRC\n"
+        "# TYPE robotcontroller_robot_crc_failures_total counter\n" + crcFailures.str();
+    out += "# HELP robotcontroller_robot_timeouts_total Requests to each robot that got no reply\n"
+        "# TYPE robotcontroller_robot_timeouts_total counter\n" + timeouts.str();
+    out += "# HELP robotcontroller_robot_retransmits_total Packets resent to each reliable-mode robot\n"
+        "# TYPE robotcontroller_robot_retransmits_total counter\n" + retransmits.str();
+    out += "# HELP robotcontroller_packet_pool_hits_total Packet buffers served from a thread's own free list\n"
+        "# TYPE robotcontroller_packet_pool_hits_total counter\n"
+        "robotcontroller_packet_pool_hits_total " + std::to_string(PacketPool::GetHits()) + "\n";
+    out += "# HELP robotcontroller_packet_pool_misses_total Packet buffers that needed the shared depot\n"
+        "# TYPE robotcontroller_packet_pool_misses_total counter\n"
+        "robotcontroller_packet_pool_misses_total " + std::to_string(PacketPool::GetMisses()) + "\n";
+    return out;
+}
+
+// Opens (or reopens) the session for robot id
+crow::response HandleConnect(const std::string& id, const crow::request& req) {
+    auto body = crow::json::load(req.body);
+    if (!body) return crow::response(400, "Invalid JSON");
+
+    std::string ip = body["ip"].s();
+    int port = body["port"].i();
+    std::string protocol = body["protocol"].s();
+    int pollHz = body.has("telemetryHz") ? static_cast<int>(body["telemetryHz"].i()) : DEFAULT_POLL_HZ;
+    ConnectionType type = (protocol == "TCP") ? ConnectionType::TCP : ConnectionType::UDP;
+    bool reliable = body.has("reliable") && body["reliable"].b();
+
+    LOG_DEBUG("Connecting robot '{}' at {}:{} using {}", id, ip, port, protocol);
+
+    try {
+        // Open streams follow the robot onto its new connection
+        std::shared_ptr<RobotSession> previous = sessions.Find(id);
+        auto session = std::make_shared<RobotSession>(id, ip, port, type, ioReactor, robotExecutor,
+            previous ? previous->GetHub() : nullptr, previous ? previous->GetHistory() : nullptr);
+        if (!session->Open(pollHz, reliable))
+            return crow::response(502, "Failed to connect to " + ip + ":" + std::to_string(port));
+
+        // The old session closes once the last request using it finishes
+        sessions.Insert(session);
+        return crow::response(200, "Connected to " + ip + ":" + std::to_string(port));
+    }
+    catch (...) {
+        return crow::response(500, "Failed to create socket");
+    }
+}
+
+// Reads a request's "timeout_ms", or DEFAULT_REPLY_TIMEOUT if it has none.
+// False if it is not a number from 1 to MAX_REPLY_TIMEOUT.
+bool ParseTimeout(const crow::json::rvalue& body, std::chrono::milliseconds& timeout) {
+    timeout = DEFAULT_REPLY_TIMEOUT;
+    if (!body.has("timeout_ms")) return true;
+    const crow::json::rvalue& value = body["timeout_ms"];
+    if (value.t() != crow::json::type::Number) return false;
+    double ms = value.d();
+    if (ms < 1 || ms > MAX_REPLY_TIMEOUT.count()) return false;
+    timeout = std::chrono::milliseconds(static_cast<int64_t>(ms));
+    return true;
+}
+
+// The answer to a timeout_ms ParseTimeout rejected
+crow::response BadTimeout() {
+    return crow::response(400, "timeout_ms must be from 1 to " + std::to_string(MAX_REPLY_TIMEOUT.count()) + ".");
+}
+
+// The DRIVE direction a telecommand names; false if it names none
+bool ParseDirection(const std::string& cmd, uint8_t& direction) {
+    if (cmd == "forward") direction = FORWARD;
+    else if (cmd == "backward") direction = BACKWARD;
+    else if (cmd == "left") direction = LEFT;
+    else if (cmd == "right") direction = RIGHT;
+    else return false;
+    return true;
+}
+
+// Fills in the DRIVE or SLEEP packet a telecommand asks for, leaving the
+// pktCount and CRC to the caller. False if the command is unknown.
+bool BuildCommand(const crow::json::rvalue& body, PktDef& packet) {
+    std::string cmd = body["command"].s();
+    int duration = body.has("duration") ? static_cast<int>(body["duration"].i()) : 0;
+    int speed = body.has("angle") ? static_cast<int>(body["angle"].i()) : 0;
+    packet.SetAck(false);
+
+    uint8_t direction;
+    if (ParseDirection(cmd, direction)) {
+        packet.SetDriveBody(direction, duration, speed);
+    }
+    else if (cmd == "sleep") {
+        packet.SetCmd(CmdType::SLEEP);
+        packet.SetBodyData(nullptr, 0);
+        return true;
+    }
+    else {
+        return false;
+    }
+    packet.SetCmd(CmdType::DRIVE);
+    return true;
+}
+
+// The text a telecommand answers with
+std::string DescribeReply(const Reply& reply) {
+    if (reply.empty()) return "Command sent. No response.";
+    PktView response(reply.data(), static_cast<int>(reply.size()));
+    bool valid = response.CheckCRC();
+    return "ACK: " + std::string(response.GetAck() ? "Yes" : "No") +
+        ", CRC: " + (valid ? "OK" : "Fail");
+}
+
+// The HTTP answer for how a telecommand went
+crow::response DescribeCommand(const CommandResult& result) {
+    switch (result.admission) {
+    case Admission::SENT:
+        return crow::response(200, DescribeReply(result.reply));
+    case Admission::PREEMPTED:
+        return crow::response(409, "Cancelled by a sleep command.");
+    case Admission::QUEUE_FULL: {
+        crow::response busy(429, "Command queue full.");
+        busy.set_header("Retry-After", "1");
+        return busy;
+    }
+    default: {
+        crow::response busy(503, "Timed out waiting in the command queue.");
+        busy.set_header("Retry-After", "1");
+        return busy;
+    }
+    }
+}
+
+// Sends one built telecommand and answers the request once it is settled
+Task<void> RunTelecommand(std::shared_ptr<RobotSession> session, PktDef packet,
+    std::chrono::milliseconds timeout, AsyncResponse response) {
+    CommandResult result = co_await session->Command(packet, timeout);
+    response.Send(DescribeCommand(result));
+}
+
+// Sends a drive or sleep command to robot id and reports its ACK. The
+// handler returns at once; the response is sent when the robot answers.
+void HandleTelecommand(const std::string& id, const crow::request& req, crow::response& res) {
+    std::shared_ptr<RobotSession> session = sessions.Find(id);
+    if (!session) {
+        res = crow::response(400, "Not connected.");
+        return res.end();
+    }
+    auto body = crow::json::load(req.body);
+    if (!body) {
+        res = crow::response(400, "Invalid JSON");
+        return res.end();
+    }
+
+    std::chrono::milliseconds timeout;
+    if (!ParseTimeout(body, timeout)) {
+        res = BadTimeout();
+        return res.end();
+    }
+
+    LOG_DEBUG("Sending command '{}' to {}:{}", std::string(body["command"].s()), session->GetIP(), session->GetPort());
+
+    Metrics::Clock::time_point buildStart = Metrics::Clock::now();
+    PktDef packet;
+    if (!BuildCommand(body, packet)) {
+        res = crow::response(400, "Unknown command");
+        return res.end();
+    }
+
+    int pktCount = session->AcquirePktCount();
+    if (pktCount < 0) {
+        res = crow::response(503, "Too many commands awaiting a reply.");
+        return res.end();
+    }
+    packet.SetPktCount(pktCount);
+    packet.CalcCRC();
+    Metrics::Record(Histogram::PKT_BUILD, buildStart);
+
+    Spawn(robotExecutor, RunTelecommand(session, packet, timeout, AsyncResponse{ req.io_service, &res }));
+}
+
+// One step of a maneuver
+struct ManeuverStep {
+    std::string command;
+    bool sleep;
+    uint8_t direction;
+    int duration;
+    int speed;
+};
+
+// Reads a {"command", "duration", "angle"} object; false if the command is
+// neither a direction nor "sleep"
+bool ParseStep(const crow::json::rvalue& json, ManeuverStep& step) {
+    step.command = json["command"].s();
+    step.sleep = step.command == "sleep";
+    step.direction = 0;
+    step.duration = json.has("duration") ? static_cast<int>(json["duration"].i()) : 0;
+    step.speed = json.has("angle") ? static_cast<int>(json["angle"].i()) : 0;
+    return step.sleep || ParseDirection(step.command, step.direction);
+}
+
+// Runs the steps one after another, each waiting for the robot's reply to
+// the one before, and stops at the first that is refused, unanswered or
+// not ACKed
+Task<void> RunManeuver(std::shared_ptr<RobotSession> session, std::vector<ManeuverStep> steps,
+    std::chrono::milliseconds timeout, AsyncResponse response) {
+    std::vector<crow::json::wvalue> entries;
+    bool completed = true;
+    for (const ManeuverStep& step : steps) {
+        CommandResult result;
+        if (step.sleep)
+            result = co_await session->Sleep(timeout);
+        else
+            result = co_await session->Drive(step.direction, step.duration, step.speed, timeout);
+        crow::response outcome = DescribeCommand(result);
+        crow::json::wvalue entry;
+        entry["command"] = step.command;
+        entry["code"] = outcome.code;
+        entry["result"] = outcome.body;
+        entries.push_back(std::move(entry));
+
+        bool acked = !result.reply.empty()
+            && PktView(result.reply.data(), static_cast<int>(result.reply.size())).GetAck();
+        if (result.admission != Admission::SENT || !acked) {
+            completed = false;
+            break;
         }
-        catch (...) {
-            return crow::response(500, "Failed to create socket");
+    }
+    crow::json::wvalue reply;
+    reply["completed"] = completed;
+    reply["steps"] = std::move(entries);
+    response.Send(crow::response(200, reply));
+}
+
+// {"steps": [{"command": ..., "duration": ..., "angle": ...}, ...], "timeout_ms": n}.
+// Every step is checked before the first is sent. The reply lists the
+// steps that ran as {"command", "code", "result"}, and "completed" says
+// whether all of them did.
+void HandleManeuver(const std::string& id, const crow::request& req, crow::response& res) {
+    std::shared_ptr<RobotSession> session = sessions.Find(id);
+    if (!session) {
+        res = crow::response(400, "Not connected.");
+        return res.end();
+    }
+    auto body = crow::json::load(req.body);
+    if (!body || !body.has("steps") || body["steps"].t() != crow::json::type::List) {
+        res = crow::response(400, "Expected {\"steps\": [...]}");
+        return res.end();
+    }
+    const crow::json::rvalue& list = body["steps"];
+    if (list.size() > static_cast<size_t>(MAX_MANEUVER_STEPS)) {
+        res = crow::response(413, "At most " + std::to_string(MAX_MANEUVER_STEPS) + " steps per maneuver.");
+        return res.end();
+    }
+    std::chrono::milliseconds timeout;
+    if (!ParseTimeout(body, timeout)) {
+        res = BadTimeout();
+        return res.end();
+    }
+
+    std::vector<ManeuverStep> steps(list.size());
+    for (size_t i = 0; i < list.size(); ++i) {
+        if (!ParseStep(list[i], steps[i])) {
+            res = crow::response(400, "Unknown command in step " + std::to_string(i));
+            return res.end();
         }
-        });
+    }
+
+    LOG_DEBUG("Running a {}-step maneuver on {}", steps.size(), id);
+    Spawn(robotExecutor, RunManeuver(session, std::move(steps), timeout, AsyncResponse{ req.io_service, &res }));
+}
+
+// What a batch has settled so far. Each run of commands only touches its
+// own entries; whichever finishes last sends the reply.
+struct BatchProgress {
+    std::vector<int> codes;
+    std::vector<std::string> results;
+    std::vector<std::string> robotIds;
+    // Runs still going, plus one per robot still starting its runs
+    std::atomic<int> left;
+    AsyncResponse response;
+
+    void Settle(int i, const crow::response& outcome) {
+        codes[i] = outcome.code;
+        results[i] = outcome.body;
+    }
+
+    // Called once per count in left; the last call answers the request
+    void Done() {
+        if (left.fetch_sub(1) != 1) return;
+        std::vector<crow::json::wvalue> entries(codes.size());
+        for (size_t i = 0; i < codes.size(); ++i) {
+            entries[i]["robot"] = robotIds[i];
+            entries[i]["code"] = codes[i];
+            entries[i]["result"] = results[i];
+        }
+        crow::json::wvalue reply;
+        reply["results"] = std::move(entries);
+        response.Send(crow::response(200, reply));
+    }
+};
+
+// One robot's share of a batch, as (index in the batch, command) pairs
+typedef std::vector<std::pair<int, ManeuverStep>> RobotCommands;
+
+// One SLEEP of a batch
+Task<void> RunBatchSleep(std::shared_ptr<RobotSession> session, int i,
+    std::chrono::milliseconds timeout, std::shared_ptr<BatchProgress> progress) {
+    CommandResult result = co_await session->Sleep(timeout);
+    progress->Settle(i, DescribeCommand(result));
+    progress->Done();
+}
+
+// One run of consecutive DRIVEs of a batch, sent as a unit
+Task<void> RunBatchDrives(std::shared_ptr<RobotSession> session, std::vector<int> indexes,
+    std::vector<DriveBody> drives, uint64_t issuedAt, std::chrono::milliseconds timeout,
+    std::shared_ptr<BatchProgress> progress) {
+    std::vector<CommandResult> results = co_await session->DriveBatch(std::move(drives), timeout, issuedAt);
+    for (size_t k = 0; k < results.size(); ++k)
+        progress->Settle(indexes[k], DescribeCommand(results[k]));
+    progress->Done();
+}
 
-    // Handle drive and sleep commands
-    CROW_ROUTE(app, "/telecommand/").methods("PUT"_method)([](const crow::request& req) {
-        if (!udpSocket) return crow::response(400, "Not connected.");
-        auto body = crow::json::load(req.body);
-        if (!body) return crow::response(400, "Invalid JSON");
-
-        std::string cmd = body["command"].s();
-        int duration = body["duration"].i();
-        int speed = body["angle"].i();
-
-        std::cout << "[DEBUG] Sending command '" << cmd << "' to " << robotIP << ":" << robotPort << std::endl;
-
-        PktDef packet;
-        packet.SetAck(false);
-        packet.SetPktCount(pktCounter++);
-
-        if (cmd == "forward") packet.SetDriveBody(FORWARD, duration, speed);
-        else if (cmd == "backward") packet.SetDriveBody(BACKWARD, duration, speed);
-        else if (cmd == "left") packet.SetDriveBody(LEFT, duration, speed);
-        else if (cmd == "right") packet.SetDriveBody(RIGHT, duration, speed);
-        else if (cmd == "sleep") {
-            packet.SetCmd(CmdType::SLEEP);
-            packet.SetBodyData(nullptr, 0);
+// Starts one robot's batched commands in array order. Each run of
+// consecutive DRIVEs goes out as one unit (one turn in the DRIVE lane, one
+// syscall), and each SLEEP goes out at once as usual. Every run or SLEEP
+// reaches the scheduler before the next one is started, so a SLEEP
+// preempts the DRIVEs queued before it and none of those after it.
+//
+// The DRIVEs count as issued when the batch arrived (issuedAt) plus the
+// batch's own SLEEPs before them, so a SLEEP sent from elsewhere since
+// preempts those still to be admitted as well as those in the queue.
+Task<void> RunRobotBatch(std::shared_ptr<RobotSession> session, RobotCommands commands,
+    uint64_t issuedAt, std::chrono::milliseconds timeout, std::shared_ptr<BatchProgress> progress) {
+    size_t next = 0;
+    while (next < commands.size()) {
+        progress->left++;
+        if (commands[next].second.sleep) {
+            Start(RunBatchSleep(session, commands[next].first, timeout, progress));
+            issuedAt++;
+            next++;
+            continue;
         }
-        else {
-            return crow::response(400, "Unknown command");
+        std::vector<int> indexes;
+        std::vector<DriveBody> drives;
+        for (; next < commands.size() && !commands[next].second.sleep; ++next) {
+            const ManeuverStep& step = commands[next].second;
+            indexes.push_back(commands[next].first);
+            drives.push_back(DriveBody{ step.direction, static_cast<uint8_t>(step.duration),
+                static_cast<uint8_t>(step.speed) });
         }
+        Start(RunBatchDrives(session, std::move(indexes), std::move(drives), issuedAt, timeout, progress));
+    }
+    progress->Done();
+    co_return;
+}
 
-        if (cmd != "sleep") packet.SetCmd(CmdType::DRIVE);
-        packet.CalcCRC();
+// {"commands": [{"robot": id, "command": ..., "duration": ..., "angle": ...}, ...],
+//  "timeout_ms": n}. "robot" defaults to the legacy default robot.
+//
+// Every robot's commands start at once and go through that robot's command
+// scheduler (see RunRobotBatch), so the whole request takes as long as its
+// busiest robot. The reply has one {"robot", "code", "result"} entry per
+// command, in order.
+void HandleTelecommandBatch(const crow::request& req, crow::response& res) {
+    auto body = crow::json::load(req.body);
+    if (!body || !body.has("commands") || body["commands"].t() != crow::json::type::List) {
+        res = crow::response(400, "Expected {\"commands\": [...]}");
+        return res.end();
+    }
+    const crow::json::rvalue& commands = body["commands"];
+    int count = static_cast<int>(commands.size());
+    if (count > MAX_BATCH_COMMANDS) {
+        res = crow::response(413, "At most " + std::to_string(MAX_BATCH_COMMANDS) + " commands per batch.");
+        return res.end();
+    }
+    std::chrono::milliseconds timeout;
+    if (!ParseTimeout(body, timeout)) {
+        res = BadTimeout();
+        return res.end();
+    }
 
-        udpSocket->SendData(packet.GenPacket(), packet.GetLength());
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto progress = std::make_shared<BatchProgress>();
+    progress->codes.resize(count);
+    progress->results.resize(count);
+    progress->robotIds.resize(count);
+    progress->response = AsyncResponse{ req.io_service, &res };
 
-        char recvBuf[1024] = {};
-        int bytes = udpSocket->GetData(recvBuf);
-        if (bytes > 0) {
-            PktDef response(recvBuf);
-            bool valid = response.CheckCRC(recvBuf, response.GetLength());
-            std::string result = "ACK: " + std::string(response.GetAck() ? "Yes" : "No") +
-                ", CRC: " + (valid ? "OK" : "Fail");
-            return crow::response(200, result);
+    // Commands grouped by robot, keeping each robot's array order
+    std::vector<std::pair<std::shared_ptr<RobotSession>, RobotCommands>> robots;
+    for (int i = 0; i < count; ++i) {
+        const crow::json::rvalue& command = commands[i];
+        std::string& robotId = progress->robotIds[i];
+        robotId = command.has("robot") ? std::string(command["robot"].s()) : DEFAULT_ROBOT_ID;
+        ManeuverStep step;
+        if (!ParseStep(command, step)) {
+            progress->Settle(i, crow::response(400, "Unknown command"));
+            continue;
         }
+        auto same = [&](const auto& robot) { return robot.first->GetId() == robotId; };
+        auto it = std::find_if(robots.begin(), robots.end(), same);
+        if (it == robots.end()) {
+            std::shared_ptr<RobotSession> session = sessions.Find(robotId);
+            if (!session) {
+                progress->Settle(i, crow::response(400, "Not connected."));
+                continue;
+            }
+            robots.emplace_back(std::move(session), RobotCommands());
+            it = robots.end() - 1;
+        }
+        it->second.emplace_back(i, std::move(step));
+    }
+
+    // One extra count, dropped below, so a robot that finishes at once
+    // cannot send the reply before the rest have started
+    progress->left = static_cast<int>(robots.size()) + 1;
+    for (auto& [session, robotCommands] : robots) {
+        LOG_DEBUG("Running {} batched commands on {}", robotCommands.size(), session->GetId());
+        Spawn(robotExecutor, RunRobotBatch(session, std::move(robotCommands), session->GetSleepsSent(), timeout, progress));
+    }
+    progress->Done();
+}
+
+// Latest telemetry for robot id
+crow::response HandleTelemetry(const std::string& id) {
+    std::shared_ptr<RobotSession> session = sessions.Find(id);
+    if (!session) return crow::response(400, "Not connected.");
+
+    // Serve the poller's latest sample without touching the robot; it is
+    // stale once three poll periods pass without a reply
+    Telemetry cached;
+    int64_t ageMs, timestampMs;
+    uint64_t samples;
+    int rate = session->GetPollRateHz();
+    if (rate > 0 && session->GetCache().Load(cached, ageMs, samples, timestampMs)) {
+        bool stale = ageMs > 3 * (1000 / rate);
+        return crow::response(200, FormatTelemetry(cached) +
+            "Age: " + std::to_string(ageMs) + " ms\n" +
+            "Stale: " + (stale ? "yes" : "no") + "\n");
+    }
+
+    // Nothing polled yet, or polling is off: ask the robot directly
+    int pktCount = session->AcquirePktCount();
+    if (pktCount < 0) return crow::response(503, "Too many requests awaiting a reply.");
+    PktDef pkt;
+    RobotSession::BuildTelemetryRequest(pkt, pktCount);
+
+    Reply reply = session->Transact(pkt, DEFAULT_REPLY_TIMEOUT);
+    if (!reply.empty()) {
+        PktView res(reply.data(), static_cast<int>(reply.size()));
+        if (res.GetCmd() == CmdType::RESPONSE) {
+            session->PublishTelemetry(res);
+            return crow::response(200, FormatTelemetry(res.ParseTelemetry()));
+        }
+    }
+
+    return crow::response(500, "No response from robot.");
+}
+
+// Appends "name":[v,v,...] for one column of a series
+template <typename T>
+void AppendColumn(std::string& out, const char* name, const std::vector<T>& column) {
+    out += '"';
+    out += name;
+    out += "\":[";
+    for (size_t i = 0; i < column.size(); ++i) {
+        if (i) out += ',';
+        out += std::to_string(column[i]);
+    }
+    out += ']';
+}
+
+// Means to two decimals; to_string would print six
+void AppendColumn(std::string& out, const char* name, const std::vector<float>& column) {
+    out += '"';
+    out += name;
+    out += "\":[";
+    char num[32];
+    for (size_t i = 0; i < column.size(); ++i) {
+        if (i) out += ',';
+        std::snprintf(num, sizeof(num), "%.2f", column[i]);
+        out += num;
+    }
+    out += ']';
+}
+
+// Appends ,"<name>Min":[...],"<name>Max":[...],"<name>Mean":[...]
+void AppendStats(std::string& out, const std::string& name, const FieldStats& stats) {
+    out += ',';
+    AppendColumn(out, (name + "Min").c_str(), stats.min);
+    out += ',';
+    AppendColumn(out, (name + "Max").c_str(), stats.max);
+    out += ',';
+    AppendColumn(out, (name + "Mean").c_str(), stats.mean);
+}
+
+// ?from=&to= (ms since the epoch, both optional) and res=raw|1s|1m.
+// Columns come back as parallel arrays, which is what charting libraries
+// take and much smaller than one object per sample.
+crow::response HandleTelemetryHistory(const std::string& id, const crow::request& req) {
+    std::shared_ptr<RobotSession> session = sessions.Find(id);
+    if (!session) return crow::response(400, "Not connected.");
+
+    const char* res = req.url_params.get("res");
+    std::string resName = res ? res : "raw";
+    Resolution resolution;
+    if (resName == "raw") resolution = Resolution::RAW;
+    else if (resName == "1s") resolution = Resolution::SECOND;
+    else if (resName == "1m") resolution = Resolution::MINUTE;
+    else return crow::response(400, "res must be raw, 1s or 1m");
+
+    // History is kept in steady time; map the wall-clock bounds onto it
+    // and the timestamps back, using the wall clock as it reads now
+    int64_t offset = TelemetryHistory::WallOffsetMs();
+    const char* from = req.url_params.get("from");
+    const char* to = req.url_params.get("to");
+    int64_t fromMs = from ? std::strtoll(from, nullptr, 10) - offset : INT64_MIN;
+    int64_t toMs = to ? std::strtoll(to, nullptr, 10) - offset : INT64_MAX;
+
+    TelemetrySeries series;
+    session->GetHistory()->Query(resolution, fromMs, toMs, series);
+    for (int64_t& at : series.timestampMs) at += offset;
 
-        return crow::response(200, "Command sent. No response.");
+    std::string body = "{\"res\":\"" + resName + "\",";
+    AppendColumn(body, "t", series.timestampMs);
+    body += ',';
+    AppendColumn(body, "lastPkt", series.lastPktCounter);
+    body += ',';
+    AppendColumn(body, "grade", series.currentGrade);
+    body += ',';
+    AppendColumn(body, "hits", series.hitCount);
+    body += ',';
+    AppendColumn(body, "cmd", series.lastCmd);
+    body += ',';
+    AppendColumn(body, "value", series.lastCmdValue);
+    body += ',';
+    AppendColumn(body, "speed", series.lastCmdSpeed);
+    if (resolution != Resolution::RAW) {
+        AppendStats(body, "grade", series.grade);
+        AppendStats(body, "hits", series.hits);
+        AppendStats(body, "speed", series.speed);
+    }
+    body += ',';
+    AppendColumn(body, "samples", series.samples);
+    body += '}';
+
+    crow::response out(200, body);
+    out.set_header("Content-Type", "application/json");
+    return out;
+}
+
+// "/robots/<id>/telemetry/stream" -> "<id>"
+std::string RobotIdFromUrl(const std::string& url) {
+    const std::string prefix = "/robots/";
+    if (url.compare(0, prefix.size(), prefix) != 0) return std::string();
+    size_t end = url.find('/', prefix.size());
+    return url.substr(prefix.size(), end == std::string::npos ? std::string::npos : end - prefix.size());
+}
+
+// A telemetry stream holds on to its robot's hub, not the session, so it
+// keeps working across reconnects and never keeps a closed socket alive
+typedef std::shared_ptr<TelemetryHub> StreamTarget;
+
+bool AcceptStream(const std::string& id, void** userdata) {
+    std::shared_ptr<RobotSession> session = sessions.Find(id);
+    if (!session) return false;
+    *userdata = new StreamTarget(session->GetHub());
+    return true;
+}
+
+void OpenStream(crow::websocket::connection& conn) {
+    StreamTarget& hub = *static_cast<StreamTarget*>(conn.userdata());
+    crow::websocket::connection* target = &conn;
+    hub->Subscribe(target, [target](const std::string& frame, bool binary, std::function<void()> written) {
+        if (binary) target->send_binary(frame, std::move(written));
+        else target->send_text(frame, std::move(written));
+        });
+}
+
+void ConfigureStream(crow::websocket::connection& conn, const std::string& data, bool) {
+    auto body = crow::json::load(data);
+    if (!body) return;
+    int maxHz = body.has("maxHz") ? static_cast<int>(body["maxHz"].i()) : DEFAULT_STREAM_HZ;
+    bool binary = body.has("format") && body["format"].s() == "binary";
+    StreamTarget& hub = *static_cast<StreamTarget*>(conn.userdata());
+    hub->Configure(&conn, maxHz, binary);
+}
+
+void CloseStream(crow::websocket::connection& conn, const std::string&) {
+    StreamTarget* hub = static_cast<StreamTarget*>(conn.userdata());
+    (*hub)->Unsubscribe(&conn);
+    delete hub;
+    conn.userdata(nullptr);
+}
+
+int main() {
+    // ROBOT_LOG_LEVEL=debug|info|warn|error|off; debug by default
+    LogLevel level;
+    const char* levelName = std::getenv("ROBOT_LOG_LEVEL");
+    if (levelName && Logger::ParseLevel(levelName, level))
+        Logger::SetLevel(level);
+    static CrowLogBridge crowLog;
+    crow::logger::setHandler(&crowLog);
+    LOG_INFO("Robot I/O uses {}", ioReactor.GetBackend() == IoBackend::IO_URING ? "io_uring" : "epoll");
+
+    crow::App<HandlerTimer> app;
+
+    if (!assets.Load())
+        LOG_WARN("Could not read static/; the GUI will not be served");
+    // Set ROBOT_DEV_ASSETS=1 to pick up GUI edits without a restart
+    if (std::getenv("ROBOT_DEV_ASSETS") && assets.StartWatching())
+        LOG_INFO("Watching static/ for changes");
+
+    // Route to serve index.html
+    CROW_ROUTE(app, "/").methods("GET"_method)([](const crow::request& req) {
+        crow::response res = ServeAsset(req, "index.html");
+        if (res.code == 404) return crow::response(500, "index.html not found.");
+        return res;
         });
 
-    // Handle telemetry requests
+    // Legacy single-robot routes, kept for the GUI; they act on "default"
+    CROW_ROUTE(app, "/connect").methods("POST"_method)([](const crow::request& req) {
+        return HandleConnect(DEFAULT_ROBOT_ID, req);
+        });
+
+    CROW_ROUTE(app, "/telecommand/").methods("PUT"_method)([&app](const crow::request& req, crow::response& res) {
+        HandleTelecommand(DEFAULT_ROBOT_ID, req, res);
+        HandlerTimer::HandlerReturned(app.get_context<HandlerTimer>(req));
+        });
+
+    CROW_ROUTE(app, "/telecommand/batch").methods("POST"_method, "PUT"_method)
+        ([&app](const crow::request& req, crow::response& res) {
+        HandleTelecommandBatch(req, res);
+        HandlerTimer::HandlerReturned(app.get_context<HandlerTimer>(req));
+            });
+
     CROW_ROUTE(app, "/telementry_request/").methods("GET"_method)([]() {
-        if (!udpSocket) return crow::response(400, "Not connected.");
-
-        PktDef pkt;
-        pkt.SetCmd(CmdType::RESPONSE);
-        pkt.SetAck(false);
-        pkt.SetPktCount(pktCounter++);
-        pkt.SetBodyData(nullptr, 0);
-        pkt.CalcCRC();
-
-        udpSocket->SendData(pkt.GenPacket(), pkt.GetLength());
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-
-        char recvBuf[1024] = {};
-        int bytes = udpSocket->GetData(recvBuf);
-        if (bytes > 0) {
-            PktDef res(recvBuf);
-            if (res.GetCmd() == CmdType::RESPONSE) {
-                Telemetry t = res.ParseTelemetry();
-                std::ostringstream oss;
-                oss << "LastPkt: " << t.lastPktCounter << "\n";
-                oss << "Grade: " << t.currentGrade << "\n";
-                oss << "HitCount: " << t.hitCount << "\n";
-                oss << "LastCmd: " << static_cast<int>(t.lastCmd) << "\n";
-                oss << "LastValue: " << static_cast<int>(t.lastCmdValue) << "\n";
-                oss << "Speed: " << static_cast<int>(t.lastCmdSpeed) << "\n";
-                return crow::response(200, oss.str());
-            }
-        }
+        return HandleTelemetry(DEFAULT_ROBOT_ID);
+        });
+
+    CROW_ROUTE(app, "/telemetry/history").methods("GET"_method)([](const crow::request& req) {
+        return HandleTelemetryHistory(DEFAULT_ROBOT_ID, req);
+        });
+
+    // Fleet routes: one session per robot ID
+    CROW_ROUTE(app, "/robots").methods("GET"_method)([]() {
+        return ListRobots();
+        });
+
+    CROW_ROUTE(app, "/robots/<string>/connect").methods("POST"_method)
+        ([](const crow::request& req, std::string id) {
+        return HandleConnect(id, req);
+            });
 
-        return crow::response(500, "No response from robot.");
+    CROW_ROUTE(app, "/robots/<string>").methods("DELETE"_method)([](std::string id) {
+        std::shared_ptr<RobotSession> closed = sessions.Remove(id);
+        if (!closed) return crow::response(404, "Unknown robot.");
+        return crow::response(200, "Disconnected " + id);
         });
 
-    std::cout << "Server running on http://0.0.0.0:18080\n";
-    app.port(18080).multithreaded().run();
+    CROW_ROUTE(app, "/robots/<string>/telecommand").methods("PUT"_method)
+        ([&app](const crow::request& req, crow::response& res, std::string id) {
+        HandleTelecommand(id, req, res);
+        HandlerTimer::HandlerReturned(app.get_context<HandlerTimer>(req));
+            });
+
+    CROW_ROUTE(app, "/robots/<string>/maneuver").methods("POST"_method)
+        ([&app](const crow::request& req, crow::response& res, std::string id) {
+        HandleManeuver(id, req, res);
+        HandlerTimer::HandlerReturned(app.get_context<HandlerTimer>(req));
+            });
+
+    CROW_ROUTE(app, "/robots/<string>/telemetry").methods("GET"_method)([](std::string id) {
+        return HandleTelemetry(id);
+        });
+
+    CROW_ROUTE(app, "/robots/<string>/telemetry/history").methods("GET"_method)
+        ([](const crow::request& req, std::string id) {
+        return HandleTelemetryHistory(id, req);
+            });
+
+    // Push telemetry to the browser as the poller receives it instead of one GET per sample.
+    // Clients may send {"maxHz": 1-100, "format": "json"|"binary"}.
+    CROW_WEBSOCKET_ROUTE(app, "/telemetry/stream")
+        .onaccept([](const crow::request&, void** userdata) {
+            return AcceptStream(DEFAULT_ROBOT_ID, userdata);
+            })
+        .onopen(OpenStream)
+        .onmessage(ConfigureStream)
+        .onclose(CloseStream);
+
+    CROW_WEBSOCKET_ROUTE(app, "/robots/<string>/telemetry/stream")
+        .onaccept([](const crow::request& req, void** userdata) {
+            return AcceptStream(RobotIdFromUrl(req.url), userdata);
+            })
+        .onopen(OpenStream)
+        .onmessage(ConfigureStream)
+        .onclose(CloseStream);
+
+    CROW_ROUTE(app, "/metrics").methods("GET"_method)([]() {
+        crow::response res(200, RenderMetrics());
+        res.set_header("Content-Type", "text/plain; version=0.0.4");
+        return res;
+        });
+
+    // Serve CSS and JS. Registered last because Crow picks the earliest
+    // matching rule, and this one would also match /robots.
+    CROW_ROUTE(app, "/<string>").methods("GET"_method)
+        ([](const crow::request& req, std::string filename) {
+        return ServeAsset(req, filename);
+            });
+
+    LOG_INFO("Server running on http://0.0.0.0:{}", SERVER_PORT);
+    unsigned cores = std::thread::hardware_concurrency();
+    app.port(SERVER_PORT)
+        .concurrency(static_cast<uint16_t>(cores > MIN_HTTP_WORKERS ? cores : MIN_HTTP_WORKERS))
+        .run();
 }
\ No newline at end of file
@@ -0,0 +1,418 @@
+﻿#include "pch.h"
+#include "CppUnitTest.h"
+#include "../RobotController/CommandScheduler.h"
+#include "../RobotController/Logger.h"
+#include "../RobotController/SessionRegistry.h"
+#include "../RobotController/TelemetryHistory.h"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace RobotControllerTests
+{
+    // Stands in for RobotSession in the registry; it only needs an ID
+    struct FakeSession {
+        std::string id;
+        const std::string& GetId() const { return id; }
+    };
+    typedef ShardedRegistry<FakeSession> FakeRegistry;
+
+    // A telemetry sample with the fields the history tests look at
+    inline Telemetry Sample(uint16_t pktCounter, uint16_t grade, uint8_t speed) {
+        return Telemetry{ pktCounter, grade, 0, 0, 0, speed };
+    }
+
+    TEST_CLASS(RobotControllerTests)
+    {
+    public:
+
+        // A DRIVE with the window free is SENT before AdmitAsync returns and leaves no ticket.
+        TEST_METHOD(Test01_CommandScheduler_FreeWindow_SentAtOnce)
+        {
+            // Arrange
+            CommandScheduler scheduler;
+            std::vector<Admission> outcomes;
+
+            // Act
+            CommandScheduler::TicketId ticket = scheduler.AdmitAsync(Lane::DRIVE,
+                [&](Admission a) { outcomes.push_back(a); });
+
+            // Assert
+            Assert::IsTrue(ticket == 0);
+            Assert::AreEqual(1, (int)outcomes.size());
+            Assert::IsTrue(outcomes[0] == Admission::SENT);
+            Assert::AreEqual(0, (int)scheduler.GetQueued());
+        }
+
+        // Queued DRIVEs get their turn in arrival order, one per Finish.
+        TEST_METHOD(Test02_CommandScheduler_Finish_GrantsInArrivalOrder)
+        {
+            // Arrange
+            CommandScheduler scheduler;
+            std::vector<int> granted;
+            scheduler.AdmitAsync(Lane::DRIVE, [](Admission) {});
+            scheduler.AdmitAsync(Lane::DRIVE, [&](Admission a) { if (a == Admission::SENT) granted.push_back(1); });
+            scheduler.AdmitAsync(Lane::DRIVE, [&](Admission a) { if (a == Admission::SENT) granted.push_back(2); });
+
+            // Act
+            scheduler.Finish(Lane::DRIVE);
+            int afterFirst = (int)granted.size();
+            scheduler.Finish(Lane::DRIVE);
+
+            // Assert
+            Assert::AreEqual(1, afterFirst);
+            Assert::AreEqual(2, (int)granted.size());
+            Assert::AreEqual(1, granted[0]);
+            Assert::AreEqual(2, granted[1]);
+            Assert::AreEqual(0, (int)scheduler.GetQueued());
+        }
+
+        // A SLEEP is SENT at once and preempts every DRIVE waiting in the queue.
+        TEST_METHOD(Test03_CommandScheduler_Safety_PreemptsQueuedDrives)
+        {
+            // Arrange
+            CommandScheduler scheduler;
+            std::vector<Admission> queued;
+            Admission sleep = Admission::QUEUE_TIMEOUT;
+            scheduler.AdmitAsync(Lane::DRIVE, [](Admission) {});
+            scheduler.AdmitAsync(Lane::DRIVE, [&](Admission a) { queued.push_back(a); });
+            scheduler.AdmitAsync(Lane::DRIVE, [&](Admission a) { queued.push_back(a); });
+
+            // Act
+            CommandScheduler::TicketId ticket = scheduler.AdmitAsync(Lane::SAFETY, [&](Admission a) { sleep = a; });
+
+            // Assert
+            Assert::IsTrue(ticket == 0);
+            Assert::IsTrue(sleep == Admission::SENT);
+            Assert::AreEqual(2, (int)queued.size());
+            Assert::IsTrue(queued[0] == Admission::PREEMPTED && queued[1] == Admission::PREEMPTED);
+            Assert::AreEqual(0, (int)scheduler.GetQueued());
+            Assert::IsTrue(scheduler.GetSleeps() == 1);
+        }
+
+        // Once MAX_QUEUED_DRIVES are waiting the next DRIVE is refused with QUEUE_FULL.
+        TEST_METHOD(Test04_CommandScheduler_QueueFull_AtMaxQueuedDrives)
+        {
+            // Arrange
+            CommandScheduler scheduler;
+            int refused = 0;
+            scheduler.AdmitAsync(Lane::DRIVE, [](Admission) {});
+            for (size_t i = 0; i < MAX_QUEUED_DRIVES; ++i)
+                scheduler.AdmitAsync(Lane::DRIVE, [&](Admission a) { if (a == Admission::QUEUE_FULL) ++refused; });
+            Admission last = Admission::SENT;
+
+            // Act
+            CommandScheduler::TicketId ticket = scheduler.AdmitAsync(Lane::DRIVE, [&](Admission a) { last = a; });
+
+            // Assert
+            Assert::IsTrue(ticket == 0);
+            Assert::AreEqual(0, refused);
+            Assert::IsTrue(last == Admission::QUEUE_FULL);
+            Assert::AreEqual((int)MAX_QUEUED_DRIVES, (int)scheduler.GetQueued());
+        }
+
+        // Withdraw times out a waiting ticket once, and does nothing after the ticket has its turn.
+        TEST_METHOD(Test05_CommandScheduler_Withdraw_TimesOutOnlyWaitingTickets)
+        {
+            // Arrange
+            CommandScheduler scheduler;
+            std::vector<Admission> first, second;
+            scheduler.AdmitAsync(Lane::DRIVE, [](Admission) {});
+            CommandScheduler::TicketId a = scheduler.AdmitAsync(Lane::DRIVE, [&](Admission r) { first.push_back(r); });
+            CommandScheduler::TicketId b = scheduler.AdmitAsync(Lane::DRIVE, [&](Admission r) { second.push_back(r); });
+
+            // Act
+            scheduler.Withdraw(a);
+            scheduler.Withdraw(a);
+            scheduler.Finish(Lane::DRIVE);
+            scheduler.Withdraw(b);
+
+            // Assert
+            Assert::IsTrue(a != 0 && b != 0 && a != b);
+            Assert::AreEqual(1, (int)first.size());
+            Assert::IsTrue(first[0] == Admission::QUEUE_TIMEOUT);
+            Assert::AreEqual(1, (int)second.size());
+            Assert::IsTrue(second[0] == Admission::SENT);
+        }
+
+        // A DRIVE issued before the last SLEEP is PREEMPTED even if the queue is empty.
+        TEST_METHOD(Test06_CommandScheduler_IssuedBeforeSleep_Preempted)
+        {
+            // Arrange
+            CommandScheduler scheduler;
+            uint64_t issuedAt = scheduler.GetSleeps();
+            scheduler.AdmitAsync(Lane::SAFETY, [](Admission) {});
+            Admission stale = Admission::SENT, fresh = Admission::PREEMPTED, unordered = Admission::PREEMPTED;
+
+            // Act
+            scheduler.AdmitAsync(Lane::DRIVE, [&](Admission a) { stale = a; }, issuedAt);
+            scheduler.AdmitAsync(Lane::DRIVE, [&](Admission a) { fresh = a; }, scheduler.GetSleeps());
+            scheduler.Finish(Lane::DRIVE);
+            scheduler.AdmitAsync(Lane::DRIVE, [&](Admission a) { unordered = a; });
+
+            // Assert
+            Assert::IsTrue(stale == Admission::PREEMPTED);
+            Assert::IsTrue(fresh == Admission::SENT);
+            Assert::IsTrue(unordered == Admission::SENT);
+        }
+
+        // A ticket's wait timer is cancelled as soon as it is granted or preempted, and cannot be set afterwards.
+        TEST_METHOD(Test07_CommandScheduler_WaitTimer_CancelledWhenTicketSettles)
+        {
+            // Arrange
+            CommandScheduler scheduler;
+            std::vector<uint64_t> cancelled;
+            scheduler.SetTimerCanceller([&](uint64_t timer) { cancelled.push_back(timer); });
+            scheduler.AdmitAsync(Lane::DRIVE, [](Admission) {});
+            CommandScheduler::TicketId granted = scheduler.AdmitAsync(Lane::DRIVE, [](Admission) {});
+            CommandScheduler::TicketId preempted = scheduler.AdmitAsync(Lane::DRIVE, [](Admission) {});
+            bool setGranted = scheduler.SetWaitTimer(granted, 11);
+            bool setPreempted = scheduler.SetWaitTimer(preempted, 12);
+
+            // Act
+            scheduler.Finish(Lane::DRIVE);
+            int afterGrant = (int)cancelled.size();
+            scheduler.AdmitAsync(Lane::SAFETY, [](Admission) {});
+            bool setLate = scheduler.SetWaitTimer(preempted, 13);
+
+            // Assert
+            Assert::IsTrue(setGranted && setPreempted);
+            Assert::IsFalse(setLate);
+            Assert::AreEqual(1, afterGrant);
+            Assert::AreEqual(2, (int)cancelled.size());
+            Assert::IsTrue(cancelled[0] == 11 && cancelled[1] == 12);
+        }
+
+        // Insert makes a session findable by its ID and Remove takes it out again.
+        TEST_METHOD(Test08_SessionRegistry_InsertFindRemove)
+        {
+            // Arrange
+            FakeRegistry registry;
+            auto robot = std::make_shared<FakeSession>(FakeSession{ "r1" });
+
+            // Act
+            std::shared_ptr<FakeSession> replaced = registry.Insert(robot);
+            std::shared_ptr<FakeSession> found = registry.Find("r1");
+            std::shared_ptr<FakeSession> missing = registry.Find("r2");
+            std::shared_ptr<FakeSession> removed = registry.Remove("r1");
+            std::shared_ptr<FakeSession> removedTwice = registry.Remove("r1");
+
+            // Assert
+            Assert::IsTrue(replaced == nullptr);
+            Assert::IsTrue(found == robot);
+            Assert::IsTrue(missing == nullptr);
+            Assert::IsTrue(removed == robot);
+            Assert::IsTrue(removedTwice == nullptr);
+            Assert::AreEqual(0, registry.GetCount());
+        }
+
+        // Inserting under an ID already in use hands back the session it replaced.
+        TEST_METHOD(Test09_SessionRegistry_Insert_ReturnsReplacedSession)
+        {
+            // Arrange
+            FakeRegistry registry;
+            auto first = std::make_shared<FakeSession>(FakeSession{ "r1" });
+            auto second = std::make_shared<FakeSession>(FakeSession{ "r1" });
+            registry.Insert(first);
+
+            // Act
+            std::shared_ptr<FakeSession> replaced = registry.Insert(second);
+
+            // Assert
+            Assert::IsTrue(replaced == first);
+            Assert::IsTrue(registry.Find("r1") == second);
+            Assert::AreEqual(1, registry.GetCount());
+        }
+
+        // ForEach visits every session once across all shards, and may call back into the registry.
+        TEST_METHOD(Test10_SessionRegistry_ForEach_VisitsEverySession)
+        {
+            // Arrange
+            FakeRegistry registry;
+            const int robots = 3 * REGISTRY_SHARDS;
+            for (int i = 0; i < robots; ++i)
+                registry.Insert(std::make_shared<FakeSession>(FakeSession{ "robot" + std::to_string(i) }));
+            std::vector<int> seen(robots, 0);
+
+            // Act
+            registry.ForEach([&](const std::shared_ptr<FakeSession>& session) {
+                seen[std::stoi(session->GetId().substr(5))]++;
+                registry.Remove(session->GetId());
+                });
+
+            // Assert
+            Assert::IsTrue(std::all_of(seen.begin(), seen.end(), [](int n) { return n == 1; }));
+            Assert::AreEqual(0, registry.GetCount());
+        }
+
+        // Threads inserting and looking up different robots at once end up with every robot registered.
+        TEST_METHOD(Test11_SessionRegistry_ConcurrentInserts_AllRegistered)
+        {
+            // Arrange
+            FakeRegistry registry;
+            const int threads = 8, perThread = 200;
+            std::vector<std::thread> workers;
+
+            // Act
+            for (int t = 0; t < threads; ++t) {
+                workers.emplace_back([&registry, t]() {
+                    for (int i = 0; i < perThread; ++i) {
+                        std::string id = std::to_string(t) + "-" + std::to_string(i);
+                        registry.Insert(std::make_shared<FakeSession>(FakeSession{ id }));
+                        registry.Find(id);
+                    }
+                    });
+            }
+            for (std::thread& worker : workers) worker.join();
+
+            // Assert
+            Assert::AreEqual(threads * perThread, registry.GetCount());
+            Assert::IsTrue(registry.Find("7-199") != nullptr);
+        }
+
+        // A 1 s bucket appears once a later sample closes it, with min/max/mean of what it covered.
+        TEST_METHOD(Test12_TelemetryHistory_SecondRollover_StatsOfBucket)
+        {
+            // Arrange
+            TelemetryHistory history;
+            history.Append(Sample(1, 10, 0), 5000);
+            history.Append(Sample(2, 30, 4), 5200);
+            history.Append(Sample(3, 20, 8), 5999);
+            TelemetrySeries before;
+            history.Query(Resolution::SECOND, INT64_MIN, INT64_MAX, before);
+
+            // Act
+            history.Append(Sample(4, 50, 0), 6000);
+            TelemetrySeries after;
+            history.Query(Resolution::SECOND, INT64_MIN, INT64_MAX, after);
+
+            // Assert
+            Assert::AreEqual(0, (int)before.timestampMs.size());
+            Assert::AreEqual(1, (int)after.timestampMs.size());
+            Assert::AreEqual((int64_t)5000, after.timestampMs[0]);
+            Assert::AreEqual(3u, after.samples[0]);
+            Assert::AreEqual((int)3, (int)after.lastPktCounter[0]);
+            Assert::AreEqual((int)10, (int)after.grade.min[0]);
+            Assert::AreEqual((int)30, (int)after.grade.max[0]);
+            Assert::AreEqual(20.0f, after.grade.mean[0]);
+            Assert::AreEqual(4.0f, after.speed.mean[0]);
+        }
+
+        // A raw sample is a bucket of one: min, max and mean are all its value.
+        TEST_METHOD(Test13_TelemetryHistory_RawSample_StatsEqualValue)
+        {
+            // Arrange
+            TelemetryHistory history;
+            TelemetrySeries series;
+
+            // Act
+            history.Append(Sample(7, 42, 3), 100);
+            history.Query(Resolution::RAW, INT64_MIN, INT64_MAX, series);
+
+            // Assert
+            Assert::AreEqual(1, (int)series.timestampMs.size());
+            Assert::AreEqual((int)42, (int)series.currentGrade[0]);
+            Assert::AreEqual((int)42, (int)series.grade.min[0]);
+            Assert::AreEqual((int)42, (int)series.grade.max[0]);
+            Assert::AreEqual(42.0f, series.grade.mean[0]);
+            Assert::AreEqual(1u, series.samples[0]);
+        }
+
+        // Once the raw ring wraps, only the newest HISTORY_RAW samples are kept, oldest first.
+        TEST_METHOD(Test14_TelemetryHistory_RawRetention_KeepsNewest)
+        {
+            // Arrange
+            TelemetryHistory history;
+            TelemetrySeries series;
+
+            // Act
+            for (int i = 0; i < HISTORY_RAW + 10; ++i)
+                history.Append(Sample(static_cast<uint16_t>(i), 0, 0), i);
+            history.Query(Resolution::RAW, INT64_MIN, INT64_MAX, series);
+
+            // Assert
+            Assert::AreEqual(HISTORY_RAW, (int)series.timestampMs.size());
+            Assert::AreEqual((int64_t)10, series.timestampMs.front());
+            Assert::AreEqual((int64_t)HISTORY_RAW + 9, series.timestampMs.back());
+        }
+
+        // The 1 s ring keeps HISTORY_SECONDS buckets and the 1 min ring keeps rolling alongside it.
+        TEST_METHOD(Test15_TelemetryHistory_SecondRetention_KeepsNewestBuckets)
+        {
+            // Arrange
+            TelemetryHistory history;
+            TelemetrySeries seconds, minutes;
+            const int buckets = HISTORY_SECONDS + 5;
+
+            // Act: two samples a second, then one more to close the last bucket
+            for (int s = 0; s <= buckets; ++s) {
+                history.Append(Sample(0, 1, 0), s * 1000LL);
+                history.Append(Sample(0, 3, 0), s * 1000LL + 500);
+            }
+            history.Query(Resolution::SECOND, INT64_MIN, INT64_MAX, seconds);
+            history.Query(Resolution::MINUTE, INT64_MIN, INT64_MAX, minutes);
+
+            // Assert
+            Assert::AreEqual(HISTORY_SECONDS, (int)seconds.timestampMs.size());
+            Assert::AreEqual((int64_t)5 * 1000, seconds.timestampMs.front());
+            Assert::AreEqual((int64_t)(buckets - 1) * 1000, seconds.timestampMs.back());
+            Assert::IsTrue(std::all_of(seconds.grade.mean.begin(), seconds.grade.mean.end(), [](float m) { return m == 2.0f; }));
+            Assert::AreEqual(buckets / 60, (int)minutes.timestampMs.size());
+            Assert::AreEqual(120u, minutes.samples.front());
+        }
+
+        // Query bounds are inclusive at both ends.
+        TEST_METHOD(Test16_TelemetryHistory_Query_InclusiveRange)
+        {
+            // Arrange
+            TelemetryHistory history;
+            for (int i = 0; i < 10; ++i) history.Append(Sample(0, 0, 0), i * 100LL);
+            TelemetrySeries series;
+
+            // Act
+            history.Query(Resolution::RAW, 200, 500, series);
+
+            // Assert
+            Assert::AreEqual(4, (int)series.timestampMs.size());
+            Assert::AreEqual((int64_t)200, series.timestampMs.front());
+            Assert::AreEqual((int64_t)500, series.timestampMs.back());
+        }
+
+        // Threads that log one after another share one ring instead of each leaving one behind.
+        TEST_METHOD(Test17_Logger_ExitedThreadRing_Reused)
+        {
+            // Arrange
+            std::thread([]() { LOG_AT(LogLevel::ERR, 0, "warm up {}", 0); }).join();
+            int before = Logger::GetRingCount();
+
+            // Act
+            for (int i = 0; i < 20; ++i)
+                std::thread([i]() { LOG_AT(LogLevel::ERR, 0, "thread {}", i); }).join();
+
+            // Assert
+            Assert::AreEqual(before, Logger::GetRingCount());
+        }
+
+        // Lines queued by a thread that has since exited are still written out by Flush.
+        TEST_METHOD(Test18_Logger_Flush_DrainsExitedThreadRing)
+        {
+            // Arrange
+            uint64_t droppedBefore = Logger::GetDropped();
+            std::thread([]() {
+                for (int i = 0; i < 50; ++i) LOG_AT(LogLevel::ERR, 0, "line {} of {}", i, 50);
+                }).join();
+
+            // Act
+            Logger::Flush();
+
+            // Assert
+            Assert::AreEqual(0u, Logger::GetPending());
+            Assert::IsTrue(Logger::GetDropped() == droppedBefore);
+        }
+    };
+}
\ No newline at end of file
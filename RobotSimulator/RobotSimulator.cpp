@@ -0,0 +1,190 @@
+#include "RobotSimulator.h"
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+
+// Chance that a DRIVE command ends with the robot being hit
+const double HIT_CHANCE = 0.02;
+const int GRADE_PER_HIT = 5;
+
+RobotSimulator::RobotSimulator(const SimOptions& opts)
+    : options(opts),
+    socket(SocketType::SERVER, "0.0.0.0", opts.port, ConnectionType::UDP, DEFAULT_SIZE),
+    running(true), nextOrder(0), rng(opts.seed), chance(0.0, 1.0), stats{ 0, 0, 0, 0, 0, 0 }
+{
+    socket.SetNonBlocking(true);
+}
+
+void RobotSimulator::Stop() {
+    running = false;
+}
+
+SimStats RobotSimulator::GetStats() const {
+    return stats;
+}
+
+// Updates the sending robot's state and queues its reply
+void RobotSimulator::Handle(const char* data, int len, const sockaddr_in& from, Clock::time_point now) {
+    PktView pkt(data, len);
+    if (!pkt.IsValid()) return;
+    stats.received++;
+
+    PktDef reply;
+    reply.SetPktCount(pkt.GetPktCount());
+    reply.SetCmd(pkt.GetCmd());
+    reply.SetBodyData(nullptr, 0);
+
+    char out[MAXPKTSIZE];
+
+    // A corrupted request is answered without the ACK bit
+    if (!pkt.CheckCRC()) {
+        stats.badCrc++;
+        reply.SetAck(false);
+        reply.CalcCRC();
+        Schedule(out, reply.SerializeInto(out, sizeof(out)), from, now);
+        return;
+    }
+    reply.SetAck(true);
+
+    uint64_t key = (static_cast<uint64_t>(from.sin_addr.s_addr) << 16) | ntohs(from.sin_port);
+    auto inserted = robots.emplace(key, RobotState{ 0, 100, 0, 0, 0, 0, DuplicateFilter() });
+    if (inserted.second) stats.robots = static_cast<int>(robots.size());
+    RobotState& robot = inserted.first->second;
+
+    int repeatLen;
+    const char* repeat = robot.seen.Find(pkt.GetPktCount(), repeatLen);
+    if (repeat) {
+        stats.duplicates++;
+        Schedule(repeat, repeatLen, from, now);
+        return;
+    }
+
+    switch (pkt.GetCmd()) {
+    case CmdType::DRIVE: {
+        DriveBody drive = pkt.GetDriveBody();
+        robot.lastPktCounter = static_cast<uint16_t>(pkt.GetPktCount());
+        robot.lastCmd = drive.direction;
+        robot.lastCmdValue = drive.duration;
+        robot.lastCmdSpeed = drive.speed;
+        if (chance(rng) < HIT_CHANCE) {
+            robot.hitCount++;
+            robot.currentGrade = robot.currentGrade > GRADE_PER_HIT ? robot.currentGrade - GRADE_PER_HIT : 0;
+        }
+        break;
+    }
+    case CmdType::RESPONSE: {
+        // Same 7-byte layout PktView::ParseTelemetry reads
+        char body[7] = {
+            static_cast<char>(robot.lastPktCounter >> 8), static_cast<char>(robot.lastPktCounter),
+            static_cast<char>(robot.currentGrade), static_cast<char>(robot.hitCount),
+            static_cast<char>(robot.lastCmd), static_cast<char>(robot.lastCmdValue),
+            static_cast<char>(robot.lastCmdSpeed) };
+        reply.SetBodyData(body, sizeof(body));
+        break;
+    }
+    default:
+        break;
+    }
+    reply.CalcCRC();
+    int outLen = reply.SerializeInto(out, sizeof(out));
+    robot.seen.Remember(pkt.GetPktCount(), out, outLen);
+    Schedule(out, outLen, from, now);
+}
+
+// Applies loss, latency and reordering, then queues the reply
+void RobotSimulator::Schedule(const char* reply, int len, const sockaddr_in& to, Clock::time_point now) {
+    if (options.lossRate > 0 && chance(rng) < options.lossRate) {
+        stats.dropped++;
+        return;
+    }
+
+    int delayMs = options.latencyMs;
+    if (options.jitterMs > 0)
+        delayMs += static_cast<int>(chance(rng) * (options.jitterMs + 1));
+    // Holding one reply back lets the ones behind it overtake
+    if (options.reorderRate > 0 && chance(rng) < options.reorderRate)
+        delayMs += options.reorderMs;
+
+    Outgoing out;
+    out.due = now + std::chrono::milliseconds(delayMs);
+    out.order = nextOrder++;
+    out.to = to;
+    out.len = len;
+    memcpy(out.data, reply, len);
+    outgoing.push(out);
+}
+
+// Sends every reply whose time has come, up to MAX_BATCH per syscall
+void RobotSimulator::FlushDue(Clock::time_point now) {
+    Outgoing batch[MAX_BATCH];
+    Datagram msgs[MAX_BATCH];
+
+    while (!outgoing.empty() && outgoing.top().due <= now) {
+        int count = 0;
+        while (count < MAX_BATCH && !outgoing.empty() && outgoing.top().due <= now) {
+            batch[count] = outgoing.top();
+            outgoing.pop();
+            msgs[count] = Datagram{ batch[count].data, batch[count].len, &batch[count].to };
+            count++;
+        }
+
+        int sent = socket.SendBatch(msgs, count);
+        if (sent < 0) sent = 0;
+        stats.sent += sent;
+        if (sent < count) {
+            // Socket buffer is full: put the rest back and try again later
+            for (int i = sent; i < count; ++i)
+                outgoing.push(batch[i]);
+            return;
+        }
+    }
+}
+
+// How long poll may sleep before the next delayed reply is due
+int RobotSimulator::NextTimeoutMs(Clock::time_point now) {
+    if (outgoing.empty()) return 100;
+    auto wait = outgoing.top().due - now;
+    if (wait <= Clock::duration::zero()) return 0;
+    int ms = static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(wait).count());
+    return ms < 100 ? ms : 100;
+}
+
+void RobotSimulator::Run(int statsSec) {
+    char bufs[MAX_BATCH][DEFAULT_SIZE];
+    sockaddr_in from[MAX_BATCH];
+    Datagram msgs[MAX_BATCH];
+    Clock::time_point nextReport = Clock::now() + std::chrono::seconds(statsSec);
+    SimStats last = stats;
+
+    pollfd pfd = { socket.GetHandle(), POLLIN, 0 };
+    while (running) {
+        poll(&pfd, 1, NextTimeoutMs(Clock::now()));
+
+        // Drain everything queued before replying, in batches
+        while (true) {
+            for (int i = 0; i < MAX_BATCH; ++i)
+                msgs[i] = Datagram{ bufs[i], DEFAULT_SIZE, &from[i] };
+            int n = socket.RecvBatch(msgs, MAX_BATCH);
+            if (n <= 0) break;
+            Clock::time_point now = Clock::now();
+            for (int i = 0; i < n; ++i)
+                Handle(msgs[i].data, msgs[i].len, from[i], now);
+            FlushDue(now);
+            if (n < MAX_BATCH) break;
+        }
+        Clock::time_point now = Clock::now();
+        FlushDue(now);
+
+        if (statsSec > 0 && now >= nextReport) {
+            std::cout << "[SIM] robots " << stats.robots
+                << "  rx/s " << (stats.received - last.received) / statsSec
+                << "  tx/s " << (stats.sent - last.sent) / statsSec
+                << "  dropped " << stats.dropped
+                << "  bad crc " << stats.badCrc
+                << "  duplicates " << stats.duplicates
+                << "  queued " << outgoing.size() << std::endl;
+            last = stats;
+            nextReport = now + std::chrono::seconds(statsSec);
+        }
+    }
+}
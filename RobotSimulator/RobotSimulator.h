@@ -0,0 +1,93 @@
+#pragma once
+#include "../MySocket/MySocket.h"
+#include "../PktDef/DuplicateFilter.h"
+#include "../PktDef/PktDef.h"
+#include "../PktDef/PktView.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <queue>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+// Fault injection and port for one simulator process
+struct SimOptions {
+    int port;
+    int latencyMs;      // added to every reply
+    int jitterMs;       // plus a random 0..jitterMs
+    double lossRate;    // fraction of replies silently dropped
+    double reorderRate; // fraction of replies held back an extra reorderMs
+    int reorderMs;
+    unsigned seed;
+};
+
+struct SimStats {
+    uint64_t received;
+    uint64_t sent;
+    uint64_t dropped;
+    uint64_t badCrc;
+    uint64_t duplicates;
+    int robots;
+};
+
+// Plays any number of robots on a single UDP port. Each distinct client
+// address is its own robot with its own telemetry state, so one simulator
+// can stand in for a whole fleet. Requests are read and replies written in
+// batches (recvmmsg/sendmmsg), and delayed replies wait in a deadline queue
+// rather than on a sleeping thread.
+class RobotSimulator {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+private:
+    // What a robot reports in its telemetry
+    struct RobotState {
+        uint16_t lastPktCounter;
+        uint16_t currentGrade;
+        uint16_t hitCount;
+        uint8_t lastCmd;
+        uint8_t lastCmdValue;
+        uint8_t lastCmdSpeed;
+        // Retransmitted requests get the reply already sent, not a rerun
+        DuplicateFilter seen;
+    };
+
+    // A reply waiting for its simulated latency to pass
+    struct Outgoing {
+        Clock::time_point due;
+        uint64_t order;
+        sockaddr_in to;
+        int len;
+        char data[MAXPKTSIZE];
+    };
+    struct LaterFirst {
+        bool operator()(const Outgoing& a, const Outgoing& b) const {
+            return a.due != b.due ? a.due > b.due : a.order > b.order;
+        }
+    };
+
+    SimOptions options;
+    MySocket socket;
+    std::atomic<bool> running;
+    std::unordered_map<uint64_t, RobotState> robots;
+    std::priority_queue<Outgoing, std::vector<Outgoing>, LaterFirst> outgoing;
+    uint64_t nextOrder;
+    std::mt19937 rng;
+    std::uniform_real_distribution<double> chance;
+    SimStats stats;
+
+    void Handle(const char* data, int len, const sockaddr_in& from, Clock::time_point now);
+    void Schedule(const char* reply, int len, const sockaddr_in& to, Clock::time_point now);
+    void FlushDue(Clock::time_point now);
+    int NextTimeoutMs(Clock::time_point now);
+
+public:
+    explicit RobotSimulator(const SimOptions& opts);
+
+    // Serves until Stop is called, printing a stats line every statsSec (0 = never)
+    void Run(int statsSec);
+    void Stop();
+
+    SimStats GetStats() const;
+};
@@ -0,0 +1,71 @@
+#include "RobotSimulator.h"
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+RobotSimulator* simulator = nullptr;
+
+void OnSignal(int) {
+    if (simulator) simulator->Stop();
+}
+
+void PrintUsage(const char* name) {
+    std::cout << "Usage: " << name << " [options]\n"
+        << "  --port N         UDP port to listen on (default 5000)\n"
+        << "  --latency MS     delay added to every reply (default 0)\n"
+        << "  --jitter MS      extra random delay, 0..MS (default 0)\n"
+        << "  --loss P         fraction of replies dropped, 0-1 (default 0)\n"
+        << "  --reorder P      fraction of replies held back to arrive out of order (default 0)\n"
+        << "  --reorder-ms MS  how long a held-back reply waits (default 20)\n"
+        << "  --seed N         random seed, for repeatable runs (default 1)\n"
+        << "  --stats SEC      print throughput every SEC seconds, 0 = off (default 1)\n";
+}
+
+int main(int argc, char* argv[]) {
+    SimOptions opts = { 5000, 0, 0, 0.0, 0.0, 20, 1 };
+    int statsSec = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            PrintUsage(argv[0]);
+            return 0;
+        }
+        if (i + 1 >= argc) {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (arg == "--port") opts.port = std::atoi(value);
+        else if (arg == "--latency") opts.latencyMs = std::atoi(value);
+        else if (arg == "--jitter") opts.jitterMs = std::atoi(value);
+        else if (arg == "--loss") opts.lossRate = std::atof(value);
+        else if (arg == "--reorder") opts.reorderRate = std::atof(value);
+        else if (arg == "--reorder-ms") opts.reorderMs = std::atoi(value);
+        else if (arg == "--seed") opts.seed = static_cast<unsigned>(std::atoi(value));
+        else if (arg == "--stats") statsSec = std::atoi(value);
+        else {
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    RobotSimulator sim(opts);
+    simulator = &sim;
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+
+    std::cout << "Robot simulator listening on UDP port " << opts.port
+        << " (latency " << opts.latencyMs << "+" << opts.jitterMs << " ms, loss " << opts.lossRate
+        << ", reorder " << opts.reorderRate << ")" << std::endl;
+    sim.Run(statsSec);
+    simulator = nullptr;
+
+    SimStats stats = sim.GetStats();
+    std::cout << "Served " << stats.robots << " robots: " << stats.received << " requests, "
+        << stats.sent << " replies, " << stats.dropped << " dropped, "
+        << stats.duplicates << " duplicates" << std::endl;
+    return 0;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+// Number of heap allocations made by the whole process so far. The global
+// operator new/delete replacement that counts them lives in AllocCounter.cpp,
+// on its own so the compiler never inlines the malloc/free pair into callers
+// and pairs a new with a free.
+long GetAllocCount();
@@ -0,0 +1,5 @@
+#include <benchmark/benchmark.h>
+
+// Shared entry point for every bench/*Bench.cpp. Pass
+// --benchmark_out=bench.json --benchmark_out_format=json to keep results.
+BENCHMARK_MAIN();
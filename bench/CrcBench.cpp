@@ -0,0 +1,51 @@
+#include <benchmark/benchmark.h>
+#include "../PktDef/PktCrc.h"
+#include "../PktDef/PktDef.h"
+#include <random>
+#include <vector>
+
+typedef uint8_t (*CrcKernel)(const char*, int);
+
+// One packet's worth of random bytes (header + largest body)
+static const std::vector<char>& Payload() {
+    static std::vector<char> bytes = [] {
+        std::vector<char> v(HEADERSIZE + MAXBODYSIZE);
+        std::mt19937 rng(42);
+        for (char& c : v) c = static_cast<char>(rng());
+        return v;
+    }();
+    return bytes;
+}
+
+// CRC over header + body for a single body size given by the benchmark argument
+static void BM_Crc(benchmark::State& state, CrcKernel kernel) {
+    const char* buf = Payload().data();
+    int size = HEADERSIZE + static_cast<int>(state.range(0));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(kernel(buf, size));
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+// CRC over every body size from 0 to MAXBODYSIZE in one iteration
+static void BM_CrcSweep(benchmark::State& state, CrcKernel kernel) {
+    const char* buf = Payload().data();
+    int64_t bytes = 0;
+    for (auto _ : state) {
+        for (int body = 0; body <= MAXBODYSIZE; ++body)
+            benchmark::DoNotOptimize(kernel(buf, HEADERSIZE + body));
+    }
+    for (int body = 0; body <= MAXBODYSIZE; ++body) bytes += HEADERSIZE + body;
+    state.SetBytesProcessed(state.iterations() * bytes);
+}
+
+BENCHMARK_CAPTURE(BM_CrcSweep, loop, CountBitsLoop);
+BENCHMARK_CAPTURE(BM_CrcSweep, table, CountBitsTable);
+BENCHMARK_CAPTURE(BM_CrcSweep, popcnt, CountBitsPopcnt);
+BENCHMARK_CAPTURE(BM_CrcSweep, avx2, CountBitsAVX2);
+BENCHMARK_CAPTURE(BM_CrcSweep, dispatch, CountBits);
+
+BENCHMARK_CAPTURE(BM_Crc, loop, CountBitsLoop)->DenseRange(0, MAXBODYSIZE, 25);
+BENCHMARK_CAPTURE(BM_Crc, table, CountBitsTable)->DenseRange(0, MAXBODYSIZE, 25);
+BENCHMARK_CAPTURE(BM_Crc, popcnt, CountBitsPopcnt)->DenseRange(0, MAXBODYSIZE, 25);
+BENCHMARK_CAPTURE(BM_Crc, avx2, CountBitsAVX2)->DenseRange(0, MAXBODYSIZE, 25);
+BENCHMARK_CAPTURE(BM_Crc, dispatch, CountBits)->DenseRange(0, MAXBODYSIZE, 25);
@@ -0,0 +1,129 @@
+#include <benchmark/benchmark.h>
+#include "../MySocket/MySocket.h"
+#include "RobotStandIn.h"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// These benchmarks drive a RobotController that is already running, by
+// default on 127.0.0.1:18080 (override with ROBOT_BENCH_HOST/ROBOT_BENCH_PORT).
+// The robot it talks to is an in-process stand-in, so the numbers cover
+// HTTP parsing, the handler, the UDP hop and ACK matching. They are skipped
+// when no server is listening.
+const int E2E_ROBOT_PORT = 27017;
+const char* E2E_ROBOT_ID = "bench";
+
+// Keep-alive HTTP/1.1 client on a MySocket TCP connection
+class HttpClient {
+private:
+    MySocket socket;
+    std::string received;
+
+public:
+    HttpClient(const std::string& host, int port)
+        : socket(SocketType::CLIENT, host, port, ConnectionType::TCP, DEFAULT_SIZE)
+    {
+        socket.ConnectTCP();
+    }
+
+    bool IsConnected() {
+        return socket.IsTCPConnected();
+    }
+
+    // Returns the status code and fills body; -1 if the connection broke
+    int Request(const char* method, const std::string& path, const std::string& payload, std::string& body) {
+        std::string req = std::string(method) + " " + path + " HTTP/1.1\r\n"
+            "Host: localhost\r\nContent-Type: application/json\r\n"
+            "Content-Length: " + std::to_string(payload.size()) + "\r\n\r\n" + payload;
+        socket.SendData(req.data(), static_cast<int>(req.size()));
+
+        char buf[DEFAULT_SIZE];
+        size_t headerEnd;
+        while ((headerEnd = received.find("\r\n\r\n")) == std::string::npos) {
+            int n = socket.GetData(buf, 2000);
+            if (n <= 0) return -1;
+            received.append(buf, n);
+        }
+
+        size_t length = 0;
+        size_t field = received.find("Content-Length: ");
+        if (field != std::string::npos && field < headerEnd)
+            length = std::strtoul(received.c_str() + field + 16, nullptr, 10);
+        while (received.size() < headerEnd + 4 + length) {
+            int n = socket.GetData(buf, 2000);
+            if (n <= 0) return -1;
+            received.append(buf, n);
+        }
+
+        int status = std::atoi(received.c_str() + 9);    // "HTTP/1.1 200"
+        body = received.substr(headerEnd + 4, length);
+        received.erase(0, headerEnd + 4 + length);
+        return status;
+    }
+};
+
+static std::string ServerHost() {
+    const char* host = std::getenv("ROBOT_BENCH_HOST");
+    return host ? host : "127.0.0.1";
+}
+
+static int ServerPort() {
+    const char* port = std::getenv("ROBOT_BENCH_PORT");
+    return port ? std::atoi(port) : 18080;
+}
+
+// Registers the stand-in with the server with polling off, so the only
+// traffic is the benchmark's own
+static bool ConnectBenchRobot(benchmark::State& state, HttpClient& http) {
+    if (!http.IsConnected()) {
+        state.SkipWithError("no RobotController listening; start it to run end-to-end benchmarks");
+        return false;
+    }
+    std::string body;
+    std::string payload = "{\"ip\":\"127.0.0.1\",\"port\":" + std::to_string(E2E_ROBOT_PORT) +
+        ",\"protocol\":\"UDP\",\"telemetryHz\":0}";
+    if (http.Request("POST", std::string("/robots/") + E2E_ROBOT_ID + "/connect", payload, body) != 200) {
+        state.SkipWithError("server refused /robots/<id>/connect");
+        return false;
+    }
+    return true;
+}
+
+// PUT /robots/<id>/telecommand -> DRIVE over UDP -> ACK -> HTTP 200
+static void BM_E2E_Telecommand(benchmark::State& state) {
+    RobotStandIn robot(E2E_ROBOT_PORT);
+    HttpClient http(ServerHost(), ServerPort());
+    if (!ConnectBenchRobot(state, http)) return;
+
+    std::string path = std::string("/robots/") + E2E_ROBOT_ID + "/telecommand";
+    std::string payload = "{\"command\":\"forward\",\"duration\":5,\"angle\":80}";
+    std::string body;
+    for (auto _ : state) {
+        if (http.Request("PUT", path, payload, body) != 200 || body.find("ACK: Yes") == std::string::npos) {
+            state.SkipWithError("telecommand was not acknowledged");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    http.Request("DELETE", std::string("/robots/") + E2E_ROBOT_ID, "", body);
+}
+BENCHMARK(BM_E2E_Telecommand)->UseRealTime();
+
+// GET /robots/<id>/telemetry with polling off, so every call is a UDP round trip
+static void BM_E2E_Telemetry(benchmark::State& state) {
+    RobotStandIn robot(E2E_ROBOT_PORT);
+    HttpClient http(ServerHost(), ServerPort());
+    if (!ConnectBenchRobot(state, http)) return;
+
+    std::string path = std::string("/robots/") + E2E_ROBOT_ID + "/telemetry";
+    std::string body;
+    for (auto _ : state) {
+        if (http.Request("GET", path, "", body) != 200) {
+            state.SkipWithError("telemetry request failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+    http.Request("DELETE", std::string("/robots/") + E2E_ROBOT_ID, "", body);
+}
+BENCHMARK(BM_E2E_Telemetry)->UseRealTime();
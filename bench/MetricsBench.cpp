@@ -0,0 +1,29 @@
+#include <benchmark/benchmark.h>
+#include "../RobotController/Metrics.h"
+
+// One histogram sample with a precomputed duration; the budget is 50 ns
+static void BM_Metrics_Record(benchmark::State& state) {
+    int64_t ns = 1;
+    for (auto _ : state) {
+        Metrics::Record(Histogram::ROBOT_RTT, ns);
+        ns = (ns * 7 + 13) & 0xFFFFFFF;    // spread samples across buckets
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Metrics_Record)->ThreadRange(1, 8);
+
+// What a hot path actually pays: two clock reads plus the record
+static void BM_Metrics_ScopedTimer(benchmark::State& state) {
+    for (auto _ : state) {
+        ScopedTimer timer(Histogram::PKT_BUILD);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Metrics_ScopedTimer)->ThreadRange(1, 8);
+
+static void BM_Metrics_Increment(benchmark::State& state) {
+    for (auto _ : state)
+        Metrics::Increment(Counter::TIMEOUTS);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Metrics_Increment)->ThreadRange(1, 8);
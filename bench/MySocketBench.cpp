@@ -0,0 +1,154 @@
+#include <benchmark/benchmark.h>
+#include "../MySocket/MySocket.h"
+#include "../PktDef/PktDef.h"
+#include "RobotStandIn.h"
+#include <vector>
+
+// Packets per benchmark iteration, so single and batch paths move the same load
+const int BURST = 32;
+const int PKT_SIZE = 9;
+const int BENCH_PORT = 27015;
+const int STANDIN_PORT = 27016;
+
+// Sends BURST datagrams with one sendto() each
+static void BM_UdpSend_Single(benchmark::State& state) {
+    MySocket sink(SocketType::SERVER, "127.0.0.1", BENCH_PORT, ConnectionType::UDP, DEFAULT_SIZE);
+    MySocket client(SocketType::CLIENT, "127.0.0.1", BENCH_PORT, ConnectionType::UDP, DEFAULT_SIZE);
+    sink.SetNonBlocking(true);
+    char pkt[PKT_SIZE] = {};
+
+    for (auto _ : state) {
+        for (int i = 0; i < BURST; ++i)
+            client.SendData(pkt, PKT_SIZE);
+        state.PauseTiming();
+        while (sink.GetData(nullptr) > 0) {}
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * BURST);
+}
+BENCHMARK(BM_UdpSend_Single);
+
+// Sends the same BURST datagrams with a single SendBatch (sendmmsg)
+static void BM_UdpSend_Batch(benchmark::State& state) {
+    MySocket sink(SocketType::SERVER, "127.0.0.1", BENCH_PORT, ConnectionType::UDP, DEFAULT_SIZE);
+    MySocket client(SocketType::CLIENT, "127.0.0.1", BENCH_PORT, ConnectionType::UDP, DEFAULT_SIZE);
+    sink.SetNonBlocking(true);
+    char pkt[PKT_SIZE] = {};
+    std::vector<Datagram> msgs(BURST, Datagram{ pkt, PKT_SIZE, nullptr });
+
+    for (auto _ : state) {
+        client.SendBatch(msgs.data(), BURST);
+        state.PauseTiming();
+        while (sink.GetData(nullptr) > 0) {}
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * BURST);
+}
+BENCHMARK(BM_UdpSend_Batch);
+
+// Receives BURST queued datagrams with one recvfrom() each
+static void BM_UdpRecv_Single(benchmark::State& state) {
+    MySocket server(SocketType::SERVER, "127.0.0.1", BENCH_PORT, ConnectionType::UDP, DEFAULT_SIZE);
+    MySocket client(SocketType::CLIENT, "127.0.0.1", BENCH_PORT, ConnectionType::UDP, DEFAULT_SIZE);
+    char pkt[PKT_SIZE] = {};
+    char buf[DEFAULT_SIZE];
+    std::vector<Datagram> msgs(BURST, Datagram{ pkt, PKT_SIZE, nullptr });
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        client.SendBatch(msgs.data(), BURST);
+        state.ResumeTiming();
+        for (int i = 0; i < BURST; ++i)
+            benchmark::DoNotOptimize(server.GetData(buf));
+    }
+    state.SetItemsProcessed(state.iterations() * BURST);
+}
+BENCHMARK(BM_UdpRecv_Single);
+
+// Receives the same BURST datagrams with RecvBatch (recvmmsg)
+static void BM_UdpRecv_Batch(benchmark::State& state) {
+    MySocket server(SocketType::SERVER, "127.0.0.1", BENCH_PORT, ConnectionType::UDP, DEFAULT_SIZE);
+    MySocket client(SocketType::CLIENT, "127.0.0.1", BENCH_PORT, ConnectionType::UDP, DEFAULT_SIZE);
+    char pkt[PKT_SIZE] = {};
+    std::vector<Datagram> out(BURST, Datagram{ pkt, PKT_SIZE, nullptr });
+    std::vector<std::vector<char>> bufs(BURST, std::vector<char>(DEFAULT_SIZE));
+    std::vector<Datagram> in(BURST);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        client.SendBatch(out.data(), BURST);
+        for (int i = 0; i < BURST; ++i)
+            in[i] = Datagram{ bufs[i].data(), DEFAULT_SIZE, nullptr };
+        state.ResumeTiming();
+        int got = 0;
+        while (got < BURST) {
+            int n = server.RecvBatch(in.data() + got, BURST - got);
+            if (n <= 0) break;
+            got += n;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * BURST);
+}
+BENCHMARK(BM_UdpRecv_Batch);
+
+// One DRIVE command to a loopback robot and back: the socket-level floor
+// under every /telecommand/ round trip
+static void BM_UdpLoopback_RTT(benchmark::State& state) {
+    RobotStandIn robot(STANDIN_PORT);
+    MySocket client(SocketType::CLIENT, "127.0.0.1", STANDIN_PORT, ConnectionType::UDP, DEFAULT_SIZE);
+    PktDef pkt;
+    pkt.SetAck(false);
+    pkt.SetDriveBody(FORWARD, 5, 80);
+    pkt.SetCmd(CmdType::DRIVE);
+    char out[MAXPKTSIZE];
+    char in[DEFAULT_SIZE];
+    int count = 0;
+
+    for (auto _ : state) {
+        pkt.SetPktCount(++count);
+        pkt.CalcCRC();
+        int size = pkt.SerializeInto(out, sizeof(out));
+        client.SendData(out, size);
+        if (client.GetData(in, 1000) <= 0) {
+            state.SkipWithError("robot stand-in did not answer");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_UdpLoopback_RTT)->UseRealTime();
+
+// Packets per second through the stand-in with up to BURST requests in flight
+static void BM_UdpLoopback_Throughput(benchmark::State& state) {
+    RobotStandIn robot(STANDIN_PORT);
+    MySocket client(SocketType::CLIENT, "127.0.0.1", STANDIN_PORT, ConnectionType::UDP, DEFAULT_SIZE);
+    PktDef pkt;
+    pkt.SetCmd(CmdType::SLEEP);
+    pkt.SetAck(false);
+    pkt.SetBodyData(nullptr, 0);
+    pkt.CalcCRC();
+    char out[MAXPKTSIZE];
+    int size = pkt.SerializeInto(out, sizeof(out));
+    std::vector<Datagram> msgs(BURST, Datagram{ out, size, nullptr });
+    std::vector<std::vector<char>> bufs(BURST, std::vector<char>(DEFAULT_SIZE));
+    std::vector<Datagram> in(BURST);
+    client.SetTimeout(1000);
+
+    for (auto _ : state) {
+        client.SendBatch(msgs.data(), BURST);
+        int got = 0;
+        while (got < BURST) {
+            for (int i = got; i < BURST; ++i)
+                in[i] = Datagram{ bufs[i].data(), DEFAULT_SIZE, nullptr };
+            int n = client.RecvBatch(in.data() + got, BURST - got);
+            if (n <= 0) break;
+            got += n;
+        }
+        if (got < BURST) {
+            state.SkipWithError("robot stand-in dropped replies");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * BURST);
+}
+BENCHMARK(BM_UdpLoopback_Throughput)->UseRealTime();
@@ -0,0 +1,167 @@
+#include <benchmark/benchmark.h>
+#include "../PktDef/PktDef.h"
+#include "../PktDef/PktTemplate.h"
+#include "../PktDef/PktView.h"
+#include "AllocCounter.h"
+#include <cstring>
+
+// Reports heap allocations per iteration; the send path should show 0
+static void ReportAllocs(benchmark::State& state, long before) {
+    long allocs = GetAllocCount() - before;
+    state.counters["allocs_per_iter"] = benchmark::Counter(
+        static_cast<double>(allocs) / static_cast<double>(state.iterations()));
+}
+
+// Builds and serializes a DRIVE telecommand the way /telecommand/ does
+static void BM_PktDef_BuildDrive_GenPacket(benchmark::State& state) {
+    int count = 0;
+    long before = GetAllocCount();
+    for (auto _ : state) {
+        PktDef packet;
+        packet.SetAck(false);
+        packet.SetPktCount(++count);
+        packet.SetDriveBody(FORWARD, 5, 80);
+        packet.SetCmd(CmdType::DRIVE);
+        packet.CalcCRC();
+        benchmark::DoNotOptimize(packet.GenPacket());
+    }
+    ReportAllocs(state, before);
+}
+BENCHMARK(BM_PktDef_BuildDrive_GenPacket);
+
+// Same packet serialized into a caller-owned stack buffer
+static void BM_PktDef_BuildDrive_SerializeInto(benchmark::State& state) {
+    int count = 0;
+    char out[MAXPKTSIZE];
+    long before = GetAllocCount();
+    for (auto _ : state) {
+        PktDef packet;
+        packet.SetAck(false);
+        packet.SetPktCount(++count);
+        packet.SetDriveBody(FORWARD, 5, 80);
+        packet.SetCmd(CmdType::DRIVE);
+        packet.CalcCRC();
+        benchmark::DoNotOptimize(packet.SerializeInto(out, sizeof(out)));
+        benchmark::ClobberMemory();
+    }
+    ReportAllocs(state, before);
+}
+BENCHMARK(BM_PktDef_BuildDrive_SerializeInto);
+
+// Empty-body SLEEP/RESPONSE request
+static void BM_PktDef_BuildEmpty_SerializeInto(benchmark::State& state) {
+    int count = 0;
+    char out[MAXPKTSIZE];
+    long before = GetAllocCount();
+    for (auto _ : state) {
+        PktDef packet;
+        packet.SetCmd(CmdType::SLEEP);
+        packet.SetAck(false);
+        packet.SetPktCount(++count);
+        packet.SetBodyData(nullptr, 0);
+        packet.CalcCRC();
+        benchmark::DoNotOptimize(packet.SerializeInto(out, sizeof(out)));
+        benchmark::ClobberMemory();
+    }
+    ReportAllocs(state, before);
+}
+BENCHMARK(BM_PktDef_BuildEmpty_SerializeInto);
+
+// A full-size packet given a new pktCount and its CRC recomputed
+static void BM_PktDef_Recount_CalcCRC(benchmark::State& state) {
+    char body[MAXBODYSIZE];
+    memset(body, 0x5A, sizeof(body));
+    PktDef packet;
+    packet.SetCmd(CmdType::RESPONSE);
+    packet.SetBodyData(body, sizeof(body));
+    int count = 0;
+    for (auto _ : state) {
+        packet.SetPktCount(++count);
+        packet.CalcCRC();
+        benchmark::DoNotOptimize(packet.GetCRC());
+    }
+}
+BENCHMARK(BM_PktDef_Recount_CalcCRC);
+
+// The same, with the CRC moved by the pktCount's bits alone
+static void BM_PktDef_Recount_UpdatePktCount(benchmark::State& state) {
+    char body[MAXBODYSIZE];
+    memset(body, 0x5A, sizeof(body));
+    PktDef packet;
+    packet.SetCmd(CmdType::RESPONSE);
+    packet.SetBodyData(body, sizeof(body));
+    packet.CalcCRC();
+    int count = 0;
+    for (auto _ : state) {
+        packet.UpdatePktCount(++count);
+        benchmark::DoNotOptimize(packet.GetCRC());
+    }
+}
+BENCHMARK(BM_PktDef_Recount_UpdatePktCount);
+
+// The same SLEEP stamped from its compile-time template
+static void BM_PktTemplate_StampSleep(benchmark::State& state) {
+    uint16_t count = 0;
+    char out[PKT_TEMPLATE_SIZE];
+    long before = GetAllocCount();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(SLEEP_TEMPLATE.Stamp(out, sizeof(out), ++count));
+        benchmark::ClobberMemory();
+    }
+    ReportAllocs(state, before);
+}
+BENCHMARK(BM_PktTemplate_StampSleep);
+
+// A constant DRIVE stamped from its template
+static void BM_PktTemplate_StampDrive(benchmark::State& state) {
+    constexpr PktTemplate drive = PktTemplate::Drive(FORWARD, 5, 80);
+    uint16_t count = 0;
+    char out[PKT_TEMPLATE_SIZE];
+    long before = GetAllocCount();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(drive.Stamp(out, sizeof(out), ++count));
+        benchmark::ClobberMemory();
+    }
+    ReportAllocs(state, before);
+}
+BENCHMARK(BM_PktTemplate_StampDrive);
+
+// One telemetry reply as it comes off the wire
+static int BuildTelemetryReply(char* out, int size) {
+    char body[7] = { 0x00, 0x2A, 100, 3, 1, 10, 90 };
+    PktDef reply;
+    reply.SetCmd(CmdType::RESPONSE);
+    reply.SetAck(true);
+    reply.SetPktCount(42);
+    reply.SetBodyData(body, sizeof(body));
+    reply.CalcCRC();
+    return reply.SerializeInto(out, size);
+}
+
+// Parses a received reply by copying it into a PktDef
+static void BM_PktDef_ParseRaw(benchmark::State& state) {
+    char raw[MAXPKTSIZE];
+    int size = BuildTelemetryReply(raw, sizeof(raw));
+    long before = GetAllocCount();
+    for (auto _ : state) {
+        PktDef pkt(raw);
+        benchmark::DoNotOptimize(pkt.CheckCRC(raw, size));
+        benchmark::DoNotOptimize(pkt.GetBodyData());
+    }
+    ReportAllocs(state, before);
+}
+BENCHMARK(BM_PktDef_ParseRaw);
+
+// Same reply decoded in place with PktView, as the dispatcher does
+static void BM_PktView_ParseTelemetry(benchmark::State& state) {
+    char raw[MAXPKTSIZE];
+    int size = BuildTelemetryReply(raw, sizeof(raw));
+    long before = GetAllocCount();
+    for (auto _ : state) {
+        PktView view(raw, size);
+        benchmark::DoNotOptimize(view.IsValid() && view.CheckCRC());
+        benchmark::DoNotOptimize(view.ParseTelemetry());
+    }
+    ReportAllocs(state, before);
+}
+BENCHMARK(BM_PktView_ParseTelemetry);
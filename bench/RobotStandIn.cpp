@@ -0,0 +1,51 @@
+#include "RobotStandIn.h"
+#include "../PktDef/PktDef.h"
+#include "../PktDef/PktView.h"
+
+RobotStandIn::RobotStandIn(int port)
+    : socket(SocketType::SERVER, "127.0.0.1", port, ConnectionType::UDP, DEFAULT_SIZE),
+    running(true), handled(0)
+{
+    loop = std::thread(&RobotStandIn::Run, this);
+}
+
+RobotStandIn::~RobotStandIn() {
+    running = false;
+    if (loop.joinable()) loop.join();
+}
+
+long RobotStandIn::GetHandled() const {
+    return handled.load();
+}
+
+void RobotStandIn::Run() {
+    while (running) {
+        // Short timeout so the destructor is never kept waiting
+        int bytes = socket.GetData(nullptr, 50);
+        if (bytes <= 0) continue;
+
+        PktView pkt(socket.GetBuffer(), bytes);
+        if (!pkt.IsValid() || !pkt.CheckCRC()) continue;
+        long count = ++handled;
+
+        PktDef reply;
+        reply.SetCmd(pkt.GetCmd());
+        reply.SetAck(true);
+        reply.SetPktCount(pkt.GetPktCount());
+        if (pkt.GetCmd() == CmdType::RESPONSE) {
+            char body[7] = {
+                static_cast<char>(pkt.GetPktCount() >> 8), static_cast<char>(pkt.GetPktCount()),
+                100, static_cast<char>(count), 1, 10, 90 };
+            reply.SetBodyData(body, sizeof(body));
+        }
+        else {
+            reply.SetBodyData(nullptr, 0);
+        }
+        reply.CalcCRC();
+
+        // A SERVER socket replies to whoever sent the last datagram
+        char out[MAXPKTSIZE];
+        int size = reply.SerializeInto(out, sizeof(out));
+        socket.SendData(out, size);
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "../MySocket/MySocket.h"
+#include <atomic>
+#include <thread>
+
+// Minimal robot on a loopback UDP port for benchmarks: ACKs every valid
+// packet with the same pktCount and answers RESPONSE requests with a
+// 7-byte telemetry body, like the real robot firmware.
+class RobotStandIn {
+private:
+    MySocket socket;
+    std::atomic<bool> running;
+    std::atomic<long> handled;
+    std::thread loop;
+
+    void Run();
+
+public:
+    explicit RobotStandIn(int port);
+    ~RobotStandIn();
+
+    long GetHandled() const;
+};
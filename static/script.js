@@ -52,6 +52,35 @@ async function requestTelemetry() {
     showToast("📡 Telemetry received");
 }
 
+// Live telemetry over a WebSocket; the server pushes each new sample
+let telemetryStream = null;
+
+function toggleTelemetryStream() {
+    const button = document.getElementById("stream-btn");
+    if (telemetryStream) {
+        telemetryStream.close();
+        return;
+    }
+
+    const scheme = location.protocol === "https:" ? "wss://" : "ws://";
+    telemetryStream = new WebSocket(scheme + location.host + "/telemetry/stream");
+    telemetryStream.onopen = () => {
+        telemetryStream.send(JSON.stringify({ maxHz: 20, format: "json" }));
+        button.textContent = "Stop Live Telemetry";
+        showToast("📡 Live telemetry started");
+    };
+    telemetryStream.onmessage = (event) => {
+        const t = JSON.parse(event.data);
+        document.getElementById("response").innerText =
+            `LastPkt: ${t.lastPkt}\nGrade: ${t.grade}\nHitCount: ${t.hits}\n` +
+            `LastCmd: ${t.lastCmd}\nLastValue: ${t.lastValue}\nSpeed: ${t.speed}\n`;
+    };
+    telemetryStream.onclose = () => {
+        telemetryStream = null;
+        button.textContent = "Start Live Telemetry";
+    };
+}
+
 // Toast notification
 function showToast(message) {
     const toast = document.getElementById("toast");